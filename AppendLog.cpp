@@ -0,0 +1,106 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include "AppendLog.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+uint32_t AppendLog::Checksum(const char* data, size_t size)
+{
+	uint32_t hash = 2166136261u; //FNV-1a
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+bool AppendLog::Write(int fd, const std::string& buffer)
+{
+	size_t written = 0;
+
+	while (written < buffer.size())
+	{
+		ssize_t bytes = ::write(fd, buffer.data() + written, buffer.size() - written);
+		if (bytes < 0)
+		{
+			if (errno == EINTR) continue;
+			return false;
+		}
+
+		written += bytes;
+	}
+
+	return true;
+}
+
+bool AppendLog::SyncDirectory(const std::string& path)
+{
+	size_t slash = path.rfind('/');
+	std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+
+	int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+	if (fd < 0) return false;
+
+	bool success = ::fsync(fd) == 0;
+	::close(fd);
+
+	return success;
+}
+
+bool AppendLog::Recover(int fd, const std::string& path, const ReplayCallback& replay, uint64_t& end)
+{
+	const size_t chunk_size = 16 * 1024 * 1024; //每次读取
+
+	std::string buffer;
+	uint64_t offset = 0; //buffer开头在文件中的位置
+	uint64_t read_offset = 0;
+
+	while (true)
+	{
+		size_t buffer_size = buffer.size();
+		buffer.resize(buffer_size + chunk_size);
+
+		ssize_t bytes = ::pread(fd, &buffer[buffer_size], chunk_size, read_offset);
+		if (bytes < 0)
+		{
+			if (errno == EINTR)
+			{
+				buffer.resize(buffer_size);
+				continue;
+			}
+
+			CP("%s:line:%d read %s failed, error:%s", __func__, __LINE__, path.c_str(), std::strerror(errno));
+			return false;
+		}
+
+		buffer.resize(buffer_size + bytes);
+		read_offset += bytes;
+
+		if (bytes == 0) break; //读完
+
+		uint64_t consumed = replay(buffer.data(), buffer.size(), offset);
+
+		buffer.erase(0, consumed);
+		offset += consumed;
+	}
+
+	if (!buffer.empty()) //末尾不完整或者损坏
+	{
+		CP("%s:line:%d %s truncated at:%lu, dropped bytes:%lu", __func__, __LINE__, path.c_str(), offset, buffer.size());
+
+		if (::ftruncate(fd, offset) != 0) return false;
+	}
+
+	end = offset;
+	return true;
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <functional>
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 追加日志的公共操作：本地存储(LogStorage)和货币流水(CurrencyLedger)共用.
+ *
+ * 记录格式由使用者决定，这里只负责校验和、写入、目录同步和启动时的恢复.
+ *
+ * 恢复：分段读取整个文件交给使用者重放，末尾不完整或者损坏的记录(写入时宕机)截断.
+ *
+ * */
+
+class AppendLog
+{
+public:
+	//重放：data在文件中从offset开始，返回有效数据的长度(末尾不完整的记录之前)
+	typedef std::function<uint64_t(const char* data, uint64_t size, uint64_t offset)> ReplayCallback;
+public:
+	static uint32_t Checksum(const char* data, size_t size); //FNV-1a
+	static bool Write(int fd, const std::string& buffer); //写入全部数据
+	static bool SyncDirectory(const std::string& path); //同步文件所在目录：改名之后目录项落盘，断电后才能看到新文件
+
+	//读取并重放整个文件，截掉末尾无效的数据；end返回有效数据的长度
+	static bool Recover(int fd, const std::string& path, const ReplayCallback& replay, uint64_t& end);
+};
+
+}
@@ -1,6 +1,12 @@
 #include "Asset.h"
+#include "Config.h"
 
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <fstream>
+#include <algorithm>
 
 namespace Adoter {
 
@@ -45,8 +51,7 @@ bool AssetManager::Load()
 		}
 	}
 	//加载所有资源数据
-	fs::path full_path(_asset_path);
-	if (!LoadAssets(full_path)) return false;
+	if (!LoadAssets(fs::path(_asset_path))) return false;
 
 	std::cout << __func__ << ":Load asset data success，asset total：" << _assets.size() << ", types total:" << _assets_bytypes.size() << std::endl;
 
@@ -54,91 +59,220 @@ bool AssetManager::Load()
 	return true;
 }
 
-bool AssetManager::LoadAssets(fs::path& full_path)
+//并行执行：task(0..count-1)，每个线程依次取下一个，当前线程也参与
+static void ParallelFor(size_t thread_count, size_t count, const std::function<void(size_t)>& task)
 {
-    	if (fs::exists(full_path))
-    	{
-        	fs::directory_iterator item_begin(full_path);
-        	fs::directory_iterator item_end;
-
-        	for ( ; item_begin != item_end; item_begin++)
-        	{
-            	if (fs::is_directory(*item_begin))
-            	{
-					std::string sub_dir_str(item_begin->path().string());
-					fs::path sub_dir(sub_dir_str);
-					LoadAssets(sub_dir);
-            	}
-            	else
-            	{
-					const std::string& filename = item_begin->path().string();
-					//////打开文件
-					std::fstream file(filename.c_str(), std::ios::in | std::ios::binary);
-					if (!file) return false; 	//如果一个有问题就退出
-
-					int32_t size = 0;
-
-					file >> size;
-					if (size == 0 || size > 1024) return false;	//理论上单个文件不会超过1024字节
-
-					char content[1024];
-					file.readsome(content, size);
-
-					std::string directory_string = item_begin->path().parent_path().string();
-					if (directory_string == "") return false;
-
-					int32_t found_pos = directory_string.find_last_of("/");
-					const std::string& message_name = directory_string.substr(found_pos + 1);	//MESSAGE名称即为文件夹名称
-
-					const pb::Descriptor* descriptor = this->_file_descriptor->FindMessageTypeByName(message_name);
-					if (!descriptor) return false;
-
-					const pb::Message* msg = pb::MessageFactory::generated_factory()->GetPrototype(descriptor);
-					if (!msg) return false;
-
-					pb::Message* message = msg->New();
-					message->ParseFromArray(content, size);
-
-					//////关闭文件
-					file.close();
-
-					////////////////////////////////////////////
-					const pb::FieldDescriptor* type_field = message->GetDescriptor()->FindFieldByName("type_t");
-					if (!type_field) return false; //如果一个有问题就退出
-
-					int64_t global_id = 0;
-
-					const pb::FieldDescriptor* prop_field = message->GetDescriptor()->FindFieldByName("common_prop");
-					if (prop_field) //普通资源
-					{
-						const pb::Message& prop_message = message->GetReflection()->GetMessage(*message, prop_field);
-						const pb::FieldDescriptor* global_id_field = prop_message.GetDescriptor()->FindFieldByName("global_id");
-						if (!global_id_field) return false;
-						global_id = prop_message.GetReflection()->GetInt64(prop_message, global_id_field);
-					}
-					else //物品资源
-					{
-						const pb::FieldDescriptor* item_prop_field = message->GetDescriptor()->FindFieldByName("item_common_prop");
-						if (!item_prop_field) return false;
-
-						const pb::Message& item_prop_message = message->GetReflection()->GetMessage(*message, item_prop_field);
-						prop_field = item_prop_message.GetDescriptor()->FindFieldByName("common_prop");
-						if (!prop_field) return false;
-
-						const pb::Message& prop_message = item_prop_message.GetReflection()->GetMessage(item_prop_message, prop_field);
-						const pb::FieldDescriptor* global_id_field = prop_message.GetDescriptor()->FindFieldByName("global_id");
-						if (!global_id_field) return false;
-						global_id = prop_message.GetReflection()->GetInt64(prop_message, global_id_field);
-					}
-					////////////////////////////////////////////加载到全局唯一表
-					_assets.emplace(global_id, message);
-
-					////////////////////////////////////////////加载到类型表
-					int32_t type_t = type_field->default_value_enum()->number();
-					_assets_bytypes[type_t].emplace(message);
-            	}
-        	}
-    	}
+	std::atomic<size_t> next(0);
+
+	auto worker = [&next, count, &task]() {
+		for (size_t index = next++; index < count; index = next++) task(index);
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < std::min(thread_count, count); ++i) threads.emplace_back(worker);
+
+	worker();
+
+	for (auto& thread : threads) thread.join();
+}
+
+static int64_t ElapsedUs(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+void AssetManager::ListAssets(const fs::path& full_path, std::vector<AssetFile>& files)
+{
+	boost::system::error_code error;
+
+	for (fs::directory_iterator it(full_path, error), end; !error && it != end; it.increment(error))
+	{
+		if (fs::is_directory(it->path(), error))
+		{
+			ListAssets(it->path(), files);
+			continue;
+		}
+
+		AssetFile file;
+		file.filename = it->path().string();
+		files.push_back(file);
+	}
+
+	if (error) std::cout << __func__ << ":list directory error:" << full_path.string() << ", " << error.message() << std::endl;
+}
+
+bool AssetManager::ParseAsset(AssetFile& asset_file)
+{
+	auto begin = std::chrono::steady_clock::now();
+
+	const std::string& filename = asset_file.filename;
+	//////打开文件
+	std::fstream file(filename.c_str(), std::ios::in | std::ios::binary);
+	if (!file) return false;
+
+	int32_t size = 0;
+
+	file >> size;
+	if (size <= 0 || size > 1024) return false;	//理论上单个文件不会超过1024字节
+
+	char content[1024];
+	file.readsome(content, size);
+
+	std::string directory_string = fs::path(filename).parent_path().string();
+	if (directory_string == "") return false;
+
+	int32_t found_pos = directory_string.find_last_of("/");
+	const std::string& message_name = directory_string.substr(found_pos + 1);	//MESSAGE名称即为文件夹名称
+
+	auto it = _prototypes.find(message_name);
+	if (it == _prototypes.end()) return false;
+
+	std::unique_ptr<pb::Message> message(it->second->New());
+	message->ParseFromArray(content, size);
+
+	//////关闭文件
+	file.close();
+
+	////////////////////////////////////////////
+	const pb::FieldDescriptor* type_field = message->GetDescriptor()->FindFieldByName("type_t");
+	if (!type_field) return false;
+
+	int64_t global_id = 0;
+
+	const pb::FieldDescriptor* prop_field = message->GetDescriptor()->FindFieldByName("common_prop");
+	if (prop_field) //普通资源
+	{
+		const pb::Message& prop_message = message->GetReflection()->GetMessage(*message, prop_field);
+		const pb::FieldDescriptor* global_id_field = prop_message.GetDescriptor()->FindFieldByName("global_id");
+		if (!global_id_field) return false;
+		global_id = prop_message.GetReflection()->GetInt64(prop_message, global_id_field);
+	}
+	else //物品资源
+	{
+		const pb::FieldDescriptor* item_prop_field = message->GetDescriptor()->FindFieldByName("item_common_prop");
+		if (!item_prop_field) return false;
+
+		const pb::Message& item_prop_message = message->GetReflection()->GetMessage(*message, item_prop_field);
+		prop_field = item_prop_message.GetDescriptor()->FindFieldByName("common_prop");
+		if (!prop_field) return false;
+
+		const pb::Message& prop_message = item_prop_message.GetReflection()->GetMessage(item_prop_message, prop_field);
+		const pb::FieldDescriptor* global_id_field = prop_message.GetDescriptor()->FindFieldByName("global_id");
+		if (!global_id_field) return false;
+		global_id = prop_message.GetReflection()->GetInt64(prop_message, global_id_field);
+	}
+
+	asset_file.global_id = global_id;
+	asset_file.type_t = type_field->default_value_enum()->number();
+	asset_file.message = message.release();
+	asset_file.parse_time = ElapsedUs(begin);
+
+	return true;
+}
+
+bool AssetManager::LoadAssets(const fs::path& full_path)
+{
+	if (!fs::exists(full_path)) return true;
+
+	int32_t thread_count = ConfigInstance.GetInt("AssetLoadThreads", std::thread::hardware_concurrency());
+	if (thread_count <= 0) thread_count = 1;
+
+	auto begin = std::chrono::steady_clock::now();
+
+	//////遍历：根目录下每个文件夹一个任务
+	std::vector<AssetFile> files;
+	std::vector<fs::path> directories;
+
+	for (fs::directory_iterator it(full_path), end; it != end; ++it)
+	{
+		if (fs::is_directory(*it)) 
+		{
+			directories.push_back(it->path());
+		}
+		else
+		{
+			AssetFile file;
+			file.filename = it->path().string();
+			files.push_back(file);
+		}
+	}
+
+	std::vector<std::vector<AssetFile>> directory_files(directories.size());
+	ParallelFor(thread_count, directories.size(), [this, &directories, &directory_files](size_t index) {
+				ListAssets(directories[index], directory_files[index]);
+			});
+
+	for (auto& list : directory_files) files.insert(files.end(), list.begin(), list.end());
+
+	//按路径排序：合并顺序与遍历顺序、线程数无关
+	std::sort(files.begin(), files.end(), [](const AssetFile& left, const AssetFile& right) { return left.filename < right.filename; });
+
+	int64_t list_time = ElapsedUs(begin);
+
+	//查找协议需要加锁，先在当前线程建好
+	_prototypes.clear();
+	for (int i = 0; i < _file_descriptor->message_type_count(); ++i)
+	{
+		const pb::Descriptor* descriptor = _file_descriptor->message_type(i);
+
+		const pb::Message* prototype = pb::MessageFactory::generated_factory()->GetPrototype(descriptor);
+		if (prototype) _prototypes.emplace(descriptor->name(), prototype);
+	}
+
+	//////解析
+	auto parse_begin = std::chrono::steady_clock::now();
+
+	ParallelFor(thread_count, files.size(), [this, &files](size_t index) {
+				ParseAsset(files[index]);
+			});
+
+	int64_t parse_time = ElapsedUs(parse_begin);
+
+	//////合并
+	struct TypeStat
+	{
+		std::string name;
+		size_t count = 0;
+		int64_t parse_time = 0;
+	};
+	std::map<int32_t, TypeStat> stats; //按类型排序输出
+
+	auto merge_begin = std::chrono::steady_clock::now();
+	size_t failed = 0;
+
+	for (const auto& file : files)
+	{
+		if (!file.message)
+		{
+			std::cout << __func__ << ":load asset error, file:" << file.filename << std::endl; //有问题的文件跳过
+			++failed;
+			continue;
+		}
+
+		////////////////////////////////////////////加载到全局唯一表
+		if (!_assets.emplace(file.global_id, file.message).second)
+		{
+			std::cout << __func__ << ":reduplicate global_id:" << file.global_id << ", file:" << file.filename << std::endl;
+		}
+
+		////////////////////////////////////////////加载到类型表
+		_assets_bytypes[file.type_t].emplace(file.message);
+
+		auto& stat = stats[file.type_t];
+		if (stat.name.empty()) stat.name = file.message->GetTypeName();
+		++stat.count;
+		stat.parse_time += file.parse_time;
+	}
+
+	int64_t merge_time = ElapsedUs(merge_begin);
+
+	for (const auto& stat : stats)
+	{
+		std::cout << __func__ << ":type:" << stat.first << " " << stat.second.name << " count:" << stat.second.count << " parse_time(us):" << stat.second.parse_time << std::endl;
+	}
+
+	std::cout << __func__ << ":threads:" << thread_count << " files:" << files.size() << " failed:" << failed 
+		<< " list_time(us):" << list_time << " parse_time(us):" << parse_time << " merge_time(us):" << merge_time << std::endl;
 
 	return true;
 } 
@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <iostream>
 #include <functional>
 #include <unordered_map>
@@ -23,6 +24,8 @@ namespace fs = boost::filesystem;
  * 
  * 自动注册(.proto)文件中的所有合法配置;
  *
+ * 启动时多线程遍历目录和解析文件，按文件路径顺序合并，结果与线程数无关；配置：AssetLoadThreads，默认CPU核数.
+ *
  * */
 
 class AssetManager : public std::enable_shared_from_this<AssetManager>
@@ -41,8 +44,21 @@ private:
 	
 	const pb::DescriptorPool* _pool = nullptr; 
 	const pb::FileDescriptor* _file_descriptor = nullptr;
+	std::unordered_map<std::string /*message_name*/, const pb::Message*> _prototypes; //解析前建好，解析线程只读
+	
+	//资源文件：解析在线程池中执行，合并在调用线程
+	struct AssetFile
+	{
+		std::string filename;
+		pb::Message* message = nullptr; //解析失败为空
+		int64_t global_id = 0;
+		int32_t type_t = 0;
+		int64_t parse_time = 0; //读取和解析耗时(US)
+	};
 private:
-	bool LoadAssets(fs::path& full_path);
+	void ListAssets(const fs::path& full_path, std::vector<AssetFile>& files); //递归遍历目录
+	bool ParseAsset(AssetFile& file); //读取并解析一个文件
+	bool LoadAssets(const fs::path& full_path);
 public:
 	AssetManager();
 
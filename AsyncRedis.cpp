@@ -0,0 +1,293 @@
+#include <thread>
+#include <cassert>
+
+#include "AsyncRedis.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+AsyncRedis::AsyncRedis(boost::asio::io_service& io_service, const RedisEndpoint& endpoint) : _io_service(io_service), _descriptor(io_service)
+{
+	_hostname = endpoint.hostname;
+	_port = endpoint.port;
+}
+
+AsyncRedis::~AsyncRedis()
+{
+	if (_context) redisAsyncFree(_context);
+}
+
+//每个io_service一组连接，随io_service销毁；连接只能在运行该io_service的线程中使用
+class AsyncRedisService : public boost::asio::io_service::service
+{
+public:
+	static boost::asio::io_service::id id;
+
+	std::vector<std::unique_ptr<AsyncRedis>> instances; //分片 -> 连接
+	std::thread::id thread_id; //运行该io_service的线程
+public:
+	explicit AsyncRedisService(boost::asio::io_service& io_service) : boost::asio::io_service::service(io_service) 
+	{
+		instances.resize(RedisShardInstance.Size());
+	}
+private:
+	void shutdown_service() override { instances.clear(); }
+};
+
+boost::asio::io_service::id AsyncRedisService::id;
+
+AsyncRedis& AsyncRedis::Instance(boost::asio::io_service& io_service, size_t shard)
+{
+	auto& service = boost::asio::use_service<AsyncRedisService>(io_service);
+
+	//网络线程的io_service只在一个线程中运行：第一次使用时记录，之后必须在同一线程
+	if (service.thread_id == std::thread::id()) service.thread_id = std::this_thread::get_id();
+	assert(service.thread_id == std::this_thread::get_id() && "AsyncRedis used outside its io_service");
+
+	if (shard >= service.instances.size()) shard = 0;
+
+	auto& instance = service.instances[shard];
+	if (!instance) instance.reset(new AsyncRedis(io_service, RedisShardInstance.GetEndpoint(shard)));
+
+	return *instance;
+}
+
+void AsyncRedis::Dispatch(boost::asio::io_service& io_service, size_t shard, std::function<void(AsyncRedis& redis)> task)
+{
+	io_service.dispatch([&io_service, shard, task]() {
+				task(Instance(io_service, shard));
+			});
+}
+
+bool AsyncRedis::Connect()
+{
+	if (_context) return true;
+
+	redisAsyncContext* context = redisAsyncConnect(_hostname.c_str(), _port); //非阻塞连接
+	if (!context) return false;
+
+	if (context->err)
+	{
+		CP("%s:line:%d redis connect error:%s", __func__, __LINE__, context->errstr);
+		redisAsyncFree(context);
+		return false;
+	}
+
+	++_generation;
+
+	_context = context;
+	_context->data = this;
+	_context->ev.data = this;
+	_context->ev.addRead = &AsyncRedis::AddRead;
+	_context->ev.delRead = &AsyncRedis::DelRead;
+	_context->ev.addWrite = &AsyncRedis::AddWrite;
+	_context->ev.delWrite = &AsyncRedis::DelWrite;
+	_context->ev.cleanup = &AsyncRedis::Cleanup;
+
+	_descriptor.assign(_context->c.fd);
+
+	redisAsyncSetConnectCallback(_context, &AsyncRedis::OnConnect);
+	redisAsyncSetDisconnectCallback(_context, &AsyncRedis::OnDisconnect);
+
+	return true;
+}
+
+void AsyncRedis::StartRead()
+{
+	if (!_reading || _read_pending) return;
+
+	_read_pending = true;
+
+	int64_t generation = _generation;
+	_descriptor.async_read_some(boost::asio::null_buffers(), [this, generation](const boost::system::error_code& error, std::size_t) {
+				if (generation != _generation) return; //旧连接
+
+				_read_pending = false;
+
+				if (error || !_context) return;
+
+				redisAsyncHandleRead(_context); //可能断开连接
+
+				StartRead();
+			});
+}
+
+void AsyncRedis::StartWrite()
+{
+	if (!_writing || _write_pending) return;
+
+	_write_pending = true;
+
+	int64_t generation = _generation;
+	_descriptor.async_write_some(boost::asio::null_buffers(), [this, generation](const boost::system::error_code& error, std::size_t) {
+				if (generation != _generation) return; //旧连接
+
+				_write_pending = false;
+
+				if (error || !_context) return;
+
+				redisAsyncHandleWrite(_context); //可能断开连接
+
+				StartWrite();
+			});
+}
+
+void AsyncRedis::AddRead(void* privdata)
+{
+	auto redis = static_cast<AsyncRedis*>(privdata);
+	redis->_reading = true;
+	redis->StartRead();
+}
+
+void AsyncRedis::DelRead(void* privdata)
+{
+	static_cast<AsyncRedis*>(privdata)->_reading = false;
+}
+
+void AsyncRedis::AddWrite(void* privdata)
+{
+	auto redis = static_cast<AsyncRedis*>(privdata);
+	redis->_writing = true;
+	redis->StartWrite();
+}
+
+void AsyncRedis::DelWrite(void* privdata)
+{
+	static_cast<AsyncRedis*>(privdata)->_writing = false;
+}
+
+void AsyncRedis::Cleanup(void* privdata)
+{
+	auto redis = static_cast<AsyncRedis*>(privdata);
+
+	redis->_reading = redis->_writing = false;
+	redis->_read_pending = redis->_write_pending = false;
+	++redis->_generation;
+
+	boost::system::error_code error;
+	redis->_descriptor.cancel(error);
+	redis->_descriptor.release(); //连接由HIREDIS关闭
+}
+
+void AsyncRedis::OnConnect(const redisAsyncContext* context, int status)
+{
+	if (status == REDIS_OK) return;
+
+	CP("%s:line:%d redis connect error:%s", __func__, __LINE__, context->errstr);
+
+	auto redis = static_cast<AsyncRedis*>(context->data);
+	if (redis && redis->_context == context) redis->_context = nullptr; //连接失败后HIREDIS释放
+}
+
+void AsyncRedis::OnDisconnect(const redisAsyncContext* context, int status)
+{
+	if (status != REDIS_OK) CP("%s:line:%d redis disconnect:%s", __func__, __LINE__, context->errstr);
+
+	auto redis = static_cast<AsyncRedis*>(context->data);
+	if (redis && redis->_context == context) redis->_context = nullptr; //下一个命令重连
+}
+
+void AsyncRedis::OnReply(redisAsyncContext* context, void* reply, void* privdata)
+{
+	std::unique_ptr<ReplyCallback> callback(static_cast<ReplyCallback*>(privdata));
+	if (callback && *callback) (*callback)(static_cast<redisReply*>(reply));
+}
+
+void AsyncRedis::Command(const std::vector<std::string>& argv, ReplyCallback callback)
+{
+	if (!Connect())
+	{
+		if (callback) callback(nullptr);
+		return;
+	}
+
+	std::vector<const char*> args;
+	std::vector<size_t> lens;
+
+	for (const auto& arg : argv)
+	{
+		args.push_back(arg.data());
+		lens.push_back(arg.size());
+	}
+
+	auto privdata = new ReplyCallback(std::move(callback));
+
+	if (REDIS_OK != redisAsyncCommandArgv(_context, &AsyncRedis::OnReply, privdata, args.size(), args.data(), lens.data()))
+	{
+		std::unique_ptr<ReplyCallback> failed(privdata);
+		if (*failed) (*failed)(nullptr);
+	}
+}
+
+void AsyncRedis::Get(const std::string& key, StringCallback callback)
+{
+	Command({"GET", key}, [callback](redisReply* reply) {
+				if (!callback) return;
+
+				if (!reply || (reply->type != REDIS_REPLY_STRING && reply->type != REDIS_REPLY_NIL)) 
+				{
+					callback(false, "");
+					return;
+				}
+
+				if (reply->type == REDIS_REPLY_NIL) callback(true, ""); //没有数据
+				else callback(true, std::string(reply->str, reply->len));
+			});
+}
+
+void AsyncRedis::Set(const std::string& key, const std::string& value, StatusCallback callback)
+{
+	Command({"SET", key, value}, [callback](redisReply* reply) {
+				bool success = reply && reply->type == REDIS_REPLY_STATUS;
+				if (!success) CP("%s:line:%d redis set failed", __func__, __LINE__);
+
+				if (callback) callback(success);
+			});
+}
+
+void AsyncRedis::Incr(const std::string& key, IntegerCallback callback)
+{
+	Command({"INCR", key}, [callback](redisReply* reply) {
+				if (!callback) return;
+
+				if (!reply || reply->type != REDIS_REPLY_INTEGER) callback(0);
+				else callback(reply->integer);
+			});
+}
+
+void AsyncRedis::Pipeline(const RedisBatch& batch, BatchCallback callback)
+{
+	if (batch.Empty())
+	{
+		if (callback) callback({});
+		return;
+	}
+
+	struct Pending
+	{
+		std::vector<RedisResult> results;
+		size_t remain = 0;
+		BatchCallback callback;
+	};
+
+	auto pending = std::make_shared<Pending>();
+	pending->results.resize(batch.Size());
+	pending->remain = batch.Size();
+	pending->callback = std::move(callback);
+
+	const auto& commands = batch.GetCommands();
+
+	for (size_t i = 0; i < commands.size(); ++i)
+	{
+		Command(commands[i], [pending, i](redisReply* reply) {
+					pending->results[i] = RedisResult(reply); //回复在回调返回后释放，需要复制
+
+					if (--pending->remain > 0) return;
+
+					if (pending->callback) pending->callback(pending->results);
+				});
+	}
+}
+
+}
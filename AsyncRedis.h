@@ -0,0 +1,88 @@
+#pragma once
+
+#include <async.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include <boost/asio.hpp>
+
+#include "RedisBatch.h"
+#include "RedisShard.h"
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 异步数据库：每个网络线程(io_service)每个分片一个连接，非阻塞，命令完成后在网络线程中回调.
+ *
+ * 连接属于io_service，随io_service销毁；只能在运行该io_service的线程中使用，其他线程先投递过去.
+ *
+ * 连接断开后下一个命令自动重连；参数按二进制传递，数据中可以包含任意字符.
+ *
+ * 说明：回调不在玩家邮箱中执行，需要修改玩家数据的回调由调用者用邮箱包装.
+ *
+ * 说明：登录流程用邮箱包装的回调串联，没有用协程(asio::spawn)：需要另外链接boost_coroutine和boost_context，每个等待中的登录还要一个独立的栈.
+ *
+ * */
+
+class AsyncRedis
+{
+public:
+	typedef std::function<void(redisReply* reply)> ReplyCallback; //reply为空则执行失败，只在回调中有效
+	typedef std::function<void(bool success, const std::string& value)> StringCallback; //数据不存在value为空
+	typedef std::function<void(bool success)> StatusCallback;
+	typedef std::function<void(int64_t value)> IntegerCallback; //失败为0
+	typedef std::function<void(const std::vector<RedisResult>& results)> BatchCallback; //结果与命令顺序一致
+private:
+	boost::asio::io_service& _io_service;
+	boost::asio::posix::stream_descriptor _descriptor;
+	redisAsyncContext* _context = nullptr;
+
+	std::string _hostname;
+	int32_t _port;
+
+	int64_t _generation = 0; //每次连接递增，忽略旧连接的回调
+	bool _reading = false; //HIREDIS需要读
+	bool _writing = false; //HIREDIS需要写
+	bool _read_pending = false; //已经在等待可读
+	bool _write_pending = false; //已经在等待可写
+private:
+	bool Connect();
+	void StartRead();
+	void StartWrite();
+
+	static void AddRead(void* privdata);
+	static void DelRead(void* privdata);
+	static void AddWrite(void* privdata);
+	static void DelWrite(void* privdata);
+	static void Cleanup(void* privdata);
+	static void OnConnect(const redisAsyncContext* context, int status);
+	static void OnDisconnect(const redisAsyncContext* context, int status);
+	static void OnReply(redisAsyncContext* context, void* reply, void* privdata);
+public:
+	AsyncRedis(boost::asio::io_service& io_service, const RedisEndpoint& endpoint);
+	~AsyncRedis();
+	AsyncRedis(AsyncRedis const& right) = delete;
+	AsyncRedis& operator=(AsyncRedis const& right) = delete;
+
+	//io_service到指定分片的连接：必须在运行该io_service的线程中调用(在其中dispatch)
+	static AsyncRedis& Instance(boost::asio::io_service& io_service, size_t shard = 0);
+	//在io_service中使用连接：已经在其中则直接执行，否则投递
+	static void Dispatch(boost::asio::io_service& io_service, size_t shard, std::function<void(AsyncRedis& redis)> task);
+
+	//执行命令：参数按二进制传递
+	void Command(const std::vector<std::string>& argv, ReplyCallback callback);
+
+	void Get(const std::string& key, StringCallback callback);
+	void Set(const std::string& key, const std::string& value, StatusCallback callback = nullptr);
+	void Incr(const std::string& key, IntegerCallback callback);
+
+	//批量执行：命令连续写入同一连接，一次往返，所有回复到齐后回调一次
+	void Pipeline(const RedisBatch& batch, BatchCallback callback = nullptr);
+};
+
+}
@@ -0,0 +1,164 @@
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+
+#include "P_Header.h"
+#include "PlayerStorage.h"
+#include "Compression.h"
+
+/*
+ * 压缩测试：按线上玩家数据的结构构造不同大小的玩家，统计序列化+压缩、解压+解析的耗时和节省的字节数.
+ *
+ * 用法：CompressBench [每种玩家的次数，默认10000] [压缩下限(字节)，默认128]
+ *
+ * */
+
+using namespace Adoter;
+
+//构造玩家：物品和通用限制的数量决定数据大小
+static void BuildPlayer(Asset::Player& stuff, int32_t item_count, int32_t limit_count, std::mt19937& random)
+{
+	int64_t now = 1500000000;
+
+	auto common_prop = stuff.mutable_common_prop();
+	common_prop->set_player_id(262144 + random() % 100000);
+	common_prop->set_level(random() % 60 + 1);
+	common_prop->set_gender(random() % 2 + 1);
+	common_prop->set_huanledou(random() % 1000000);
+	common_prop->set_diamond(random() % 10000);
+
+	auto inventory = stuff.mutable_inventory()->mutable_inventory()->Add();
+	inventory->set_inventory_type(Asset::INVENTORY_TYPE_BACKAGE);
+
+	for (int32_t i = 0; i < item_count; ++i)
+	{
+		auto item = inventory->mutable_items()->Add();
+		item->mutable_common_prop()->set_global_id(131073 + random() % 200); //物品种类有限
+		item->set_inventory(Asset::INVENTORY_TYPE_BACKAGE);
+		item->set_count(random() % 99 + 1);
+		item->set_quality(random() % 5 + 1);
+	}
+
+	for (int32_t i = 0; i < limit_count; ++i)
+	{
+		auto element = stuff.mutable_common_limit()->mutable_elements()->Add();
+		element->set_common_limit_id(655361 + i);
+		element->set_time_stamp(now + random() % 86400);
+		element->set_count(random() % 5 + 1);
+	}
+
+	stuff.mutable_player_prop()->set_room_id(random() % 100000);
+	stuff.mutable_player_prop()->set_pai_oper_count(random() % 1000);
+	stuff.set_login_time(now);
+	stuff.set_logout_time(now + random() % 3600);
+
+	for (int32_t i = 0; i < limit_count / 4; ++i) stuff.mutable_sign_time()->Add(now - i * 86400);
+}
+
+static int64_t Elapsed(std::chrono::steady_clock::time_point begin)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+}
+
+int main(int argc, const char* argv[])
+{
+	int32_t times = argc > 1 ? std::atoi(argv[1]) : 10000;
+	size_t min_size = argc > 2 ? std::atoi(argv[2]) : 128;
+	if (times <= 0) times = 10000;
+
+	struct Shape
+	{
+		const char* name;
+		int32_t item_count;
+		int32_t limit_count;
+	};
+
+	const Shape shapes[] = {
+		{ "new", 0, 2 }, //新玩家
+		{ "normal", 30, 20 },
+		{ "active", 150, 100 },
+		{ "veteran", 800, 400 },
+	};
+
+	std::mt19937 random(20170801);
+
+	std::cout << "shape\traw\tstored\tsaved\tencode(ns)\tdecode(ns)\traw_encode(ns)\traw_decode(ns)" << std::endl;
+
+	for (const auto& shape : shapes)
+	{
+		std::vector<Asset::Player> players(16);
+		for (auto& stuff : players) BuildPlayer(stuff, shape.item_count, shape.limit_count, random);
+
+		uint64_t raw_bytes = 0, stored_bytes = 0;
+		int64_t encode_time = 0, decode_time = 0, raw_encode_time = 0, raw_decode_time = 0;
+
+		for (int32_t i = 0; i < times; ++i)
+		{
+			const Asset::Player& stuff = players[i % players.size()];
+
+			//不压缩：分段序列化，拼接后解析
+			auto begin = std::chrono::steady_clock::now();
+
+			PlayerSections sections;
+			PlayerStorage::Split(stuff, sections);
+
+			raw_encode_time += Elapsed(begin);
+
+			begin = std::chrono::steady_clock::now();
+
+			std::string raw;
+			for (const auto& section : sections) raw += section.second;
+
+			Asset::Player loaded;
+			loaded.ParseFromString(raw);
+
+			raw_decode_time += Elapsed(begin);
+
+			//压缩：分段序列化后每段压缩，解压后拼接解析
+			begin = std::chrono::steady_clock::now();
+
+			PlayerSections split, encoded;
+			PlayerStorage::Split(stuff, split);
+			for (const auto& section : split) Compression::Encode(section.second, min_size, encoded[section.first]);
+
+			encode_time += Elapsed(begin);
+
+			begin = std::chrono::steady_clock::now();
+
+			std::string decoded, data;
+			for (const auto& section : encoded)
+			{
+				if (!Compression::Decode(section.second, data))
+				{
+					std::cerr << "decode failed, shape:" << shape.name << " section:" << section.first << std::endl;
+					return 1;
+				}
+				decoded += data;
+			}
+
+			loaded.Clear();
+			loaded.ParseFromString(decoded);
+
+			decode_time += Elapsed(begin);
+
+			if (decoded.size() != raw.size() || loaded.ByteSize() != stuff.ByteSize())
+			{
+				std::cerr << "mismatch, shape:" << shape.name << std::endl;
+				return 2;
+			}
+
+			raw_bytes += raw.size();
+			for (const auto& section : encoded) stored_bytes += section.second.size();
+		}
+
+		std::cout << shape.name << "\t" << raw_bytes / times << "\t" << stored_bytes / times << "\t"
+			<< (raw_bytes ? 100 - stored_bytes * 100 / raw_bytes : 0) << "%\t"
+			<< encode_time / times << "\t" << decode_time / times << "\t"
+			<< raw_encode_time / times << "\t" << raw_decode_time / times << std::endl;
+	}
+
+	return 0;
+}
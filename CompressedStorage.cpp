@@ -0,0 +1,154 @@
+#include "CompressedStorage.h"
+#include "Compression.h"
+#include "Config.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+CompressedStorage::CompressedStorage(std::unique_ptr<Storage> storage) : _storage(std::move(storage))
+{
+	_enabled = ConfigInstance.GetBool("StorageCompress", false);
+
+	int32_t min_size = ConfigInstance.GetInt("StorageCompressMinSize", 128);
+	_min_size = min_size > 0 ? min_size : 128;
+}
+
+void CompressedStorage::Encode(const std::string& value, std::string& out)
+{
+	if (_enabled) Compression::Encode(value, _min_size, out);
+	else Compression::Encode(value, SIZE_MAX, out); //不压缩，只处理0x00开头的数据
+}
+
+void CompressedStorage::Encode(const PlayerSections& sections, PlayerSections& out)
+{
+	for (const auto& section : sections) Encode(section.second, out[section.first]);
+}
+
+bool CompressedStorage::Decode(PlayerRecord& record)
+{
+	if (!record.success) return false;
+
+	if (record.sections.empty()) //旧数据
+	{
+		if (!Compression::IsEncoded(record.stuff)) return true;
+
+		std::string stuff;
+		if (!Compression::Decode(record.stuff, stuff)) return false;
+
+		record.stuff.swap(stuff);
+		return true;
+	}
+
+	bool encoded = false;
+	for (const auto& section : record.sections)
+	{
+		if (Compression::IsEncoded(section.second))
+		{
+			encoded = true;
+			break;
+		}
+	}
+
+	if (!encoded) return true; //没有压缩过的段，不需要重新拼接
+
+	record.stuff.clear();
+
+	for (auto& section : record.sections)
+	{
+		std::string data;
+		if (!Compression::Decode(section.second, data)) return false;
+
+		section.second.swap(data);
+		record.stuff += section.second;
+	}
+
+	return true;
+}
+
+void CompressedStorage::GetUser(boost::asio::io_service& io_service, const std::string& username, StringCallback callback)
+{
+	_storage->GetUser(io_service, username, [username, callback](bool success, const std::string& value) {
+				std::string user;
+
+				if (success && !Compression::Decode(value, user))
+				{
+					CP("%s:line:%d decode user failed, username:%s", __func__, __LINE__, username.c_str());
+					success = false;
+				}
+
+				if (callback) callback(success, user);
+			});
+}
+
+void CompressedStorage::SetUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, StatusCallback callback)
+{
+	std::string user;
+	Encode(value, user);
+
+	_storage->SetUser(io_service, username, user, callback);
+}
+
+void CompressedStorage::LoginUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, int64_t player_id, LoginCallback callback)
+{
+	std::string user;
+	Encode(value, user);
+
+	_storage->LoginUser(io_service, username, user, player_id, [username, callback](bool success, int64_t player_id, const std::string& value) {
+				std::string user;
+
+				if (success && !Compression::Decode(value, user))
+				{
+					CP("%s:line:%d decode user failed, username:%s", __func__, __LINE__, username.c_str());
+					success = false;
+				}
+
+				if (callback) callback(success, player_id, user);
+			});
+}
+
+void CompressedStorage::LoadPlayer(boost::asio::io_service& io_service, int64_t player_id, PlayerCallback callback)
+{
+	_storage->LoadPlayer(io_service, player_id, [this, player_id, callback](const PlayerRecord& record) {
+				PlayerRecord decoded = record;
+
+				if (decoded.success && !Decode(decoded))
+				{
+					CP("%s:line:%d decode player failed, player_id:%ld", __func__, __LINE__, player_id);
+					decoded.success = false;
+				}
+
+				if (callback) callback(decoded);
+			});
+}
+
+void CompressedStorage::SavePlayer(boost::asio::io_service& io_service, int64_t player_id, const PlayerSections& sections, StatusCallback callback)
+{
+	PlayerSections encoded;
+	Encode(sections, encoded);
+
+	_storage->SavePlayer(io_service, player_id, encoded, callback);
+}
+
+void CompressedStorage::LoadPlayers(const std::vector<int64_t>& player_list, std::vector<PlayerRecord>& records)
+{
+	_storage->LoadPlayers(player_list, records);
+
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		if (!records[i].success || Decode(records[i])) continue;
+
+		CP("%s:line:%d decode player failed, player_id:%ld", __func__, __LINE__, player_list[i]);
+		records[i].success = false;
+	}
+}
+
+bool CompressedStorage::SavePlayers(const PlayerBatch& players, std::vector<int64_t>& failed)
+{
+	PlayerBatch encoded;
+	for (const auto& player : players) Encode(player.second, encoded[player.first]);
+
+	return _storage->SavePlayers(encoded, failed);
+}
+
+}
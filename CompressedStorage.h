@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+
+#include "Storage.h"
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 压缩存储：包装实际的存储，写入前压缩账号数据和玩家的每一段，读取后解压，游戏逻辑和存储实现不需要修改.
+ *
+ * 读取总是解压(兼容关闭压缩之前写入的数据)，写入是否压缩由配置决定；没有头部的旧数据原样读取.
+ *
+ * 配置：
+ *
+ * StorageCompress：写入时压缩，默认false.
+ *
+ * StorageCompressMinSize：小于该大小(字节)不压缩，默认128.
+ *
+ * */
+
+class CompressedStorage : public Storage
+{
+private:
+	std::unique_ptr<Storage> _storage;
+	bool _enabled = false;
+	size_t _min_size = 128;
+private:
+	void Encode(const std::string& value, std::string& out);
+	void Encode(const PlayerSections& sections, PlayerSections& out);
+	bool Decode(PlayerRecord& record); //解压各段并重新拼接
+public:
+	explicit CompressedStorage(std::unique_ptr<Storage> storage);
+
+	void GetUser(boost::asio::io_service& io_service, const std::string& username, StringCallback callback) override;
+	void SetUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, StatusCallback callback = nullptr) override;
+	void LoginUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, int64_t player_id, LoginCallback callback) override;
+
+	void LoadPlayer(boost::asio::io_service& io_service, int64_t player_id, PlayerCallback callback) override;
+	void SavePlayer(boost::asio::io_service& io_service, int64_t player_id, const PlayerSections& sections, StatusCallback callback = nullptr) override;
+
+	void LoadPlayers(const std::vector<int64_t>& player_list, std::vector<PlayerRecord>& records) override;
+	bool SavePlayers(const PlayerBatch& players, std::vector<int64_t>& failed) override;
+
+	int64_t IncrBy(const std::string& key, int64_t count) override { return _storage->IncrBy(key, count); }
+
+	bool GetOnlinePlayers(std::vector<int64_t>& player_list) override { return _storage->GetOnlinePlayers(player_list); }
+	bool SetOnlinePlayers(const std::vector<int64_t>& player_list) override { return _storage->SetOnlinePlayers(player_list); }
+};
+
+}
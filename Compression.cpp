@@ -0,0 +1,202 @@
+#include <cstring>
+#include <algorithm>
+
+#include "Compression.h"
+
+namespace Adoter
+{
+
+static const size_t HASH_LOG = 12; //哈希表4096项
+static const size_t MAX_LITERAL = 32; //一段字面量最多32字节
+static const size_t MAX_OFFSET = 8192; //最大回溯距离
+static const size_t MAX_MATCH = 264; //最长匹配
+static const size_t MAX_RAW_SIZE = 64 * 1024 * 1024; //原始长度上限，防止损坏数据申请过大内存
+
+static inline uint32_t Hash(const uint8_t* p)
+{
+	uint32_t value = (p[0] << 16) | (p[1] << 8) | p[2];
+	return (value * 2654435761u) >> (32 - HASH_LOG);
+}
+
+//字面量：控制字节(长度-1，小于32) 数据
+static inline void EmitLiterals(const uint8_t* data, size_t size, std::string& out)
+{
+	while (size > 0)
+	{
+		size_t count = std::min(size, MAX_LITERAL);
+
+		out.push_back(static_cast<char>(count - 1));
+		out.append(reinterpret_cast<const char*>(data), count);
+
+		data += count;
+		size -= count;
+	}
+}
+
+void Compression::Compress(const char* data, size_t size, std::string& out)
+{
+	const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+
+	out.clear();
+	out.reserve(size + size / MAX_LITERAL + 1);
+
+	uint32_t table[1 << HASH_LOG];
+	std::fill(table, table + (1 << HASH_LOG), UINT32_MAX);
+
+	size_t ip = 0, literal = 0;
+
+	while (ip + 2 < size)
+	{
+		uint32_t& slot = table[Hash(in + ip)];
+		size_t ref = slot;
+		slot = ip;
+
+		if (ref == UINT32_MAX || ip - ref > MAX_OFFSET || std::memcmp(in + ref, in + ip, 3) != 0)
+		{
+			++ip;
+			continue;
+		}
+
+		EmitLiterals(in + literal, ip - literal, out);
+
+		size_t max_match = std::min(size - ip, MAX_MATCH);
+		size_t match = 3;
+		while (match < max_match && in[ref + match] == in[ip + match]) ++match;
+
+		//回溯：控制字节(长度-2，3位；偏移高5位) [长度-9] 偏移低8位
+		size_t length = match - 2, offset = ip - ref - 1;
+
+		if (length < 7)
+		{
+			out.push_back(static_cast<char>((length << 5) | (offset >> 8)));
+		}
+		else
+		{
+			out.push_back(static_cast<char>((7 << 5) | (offset >> 8)));
+			out.push_back(static_cast<char>(length - 7));
+		}
+		out.push_back(static_cast<char>(offset & 0xff));
+
+		ip += match;
+		literal = ip;
+	}
+
+	EmitLiterals(in + literal, size - literal, out);
+}
+
+bool Compression::Decompress(const char* data, size_t size, size_t raw_size, std::string& out)
+{
+	const uint8_t* in = reinterpret_cast<const uint8_t*>(data);
+
+	out.resize(raw_size);
+	char* op = &out[0];
+	size_t ip = 0, written = 0;
+
+	while (ip < size)
+	{
+		size_t ctrl = in[ip++];
+
+		if (ctrl < MAX_LITERAL)
+		{
+			size_t count = ctrl + 1;
+			if (count > size - ip || count > raw_size - written) return false;
+
+			std::memcpy(op + written, in + ip, count);
+			ip += count;
+			written += count;
+			continue;
+		}
+
+		size_t length = ctrl >> 5;
+		if (length == 7)
+		{
+			if (ip >= size) return false;
+			length += in[ip++];
+		}
+		if (ip >= size) return false;
+
+		size_t offset = ((ctrl & 0x1f) << 8) + in[ip++] + 1;
+		length += 2;
+
+		if (offset > written || length > raw_size - written) return false;
+
+		for (size_t i = 0; i < length; ++i, ++written) op[written] = op[written - offset]; //可能重叠，逐字节复制
+	}
+
+	return written == raw_size;
+}
+
+void Compression::Encode(const std::string& value, size_t min_size, std::string& out)
+{
+	std::string header(1, 0);
+
+	if (value.size() >= min_size && value.size() <= MAX_RAW_SIZE)
+	{
+		std::string compressed;
+		Compress(value.data(), value.size(), compressed);
+
+		header.push_back(CODEC_LZF);
+		for (size_t raw_size = value.size(); ; raw_size >>= 7) //原始长度：VARINT
+		{
+			if (raw_size < 0x80)
+			{
+				header.push_back(static_cast<char>(raw_size));
+				break;
+			}
+			header.push_back(static_cast<char>((raw_size & 0x7f) | 0x80));
+		}
+
+		if (header.size() + compressed.size() < value.size())
+		{
+			out = header + compressed;
+			return;
+		}
+
+		header.resize(1);
+	}
+
+	if (IsEncoded(value)) //原始数据以0x00开头，加头部以免当作压缩数据
+	{
+		header.push_back(CODEC_STORED);
+		out = header + value;
+		return;
+	}
+
+	out = value;
+}
+
+bool Compression::Decode(const std::string& value, std::string& out)
+{
+	if (!IsEncoded(value))
+	{
+		out = value;
+		return true;
+	}
+
+	if (value.size() < 2) return false;
+
+	if (value[1] == CODEC_STORED)
+	{
+		out.assign(value, 2, std::string::npos);
+		return true;
+	}
+
+	if (value[1] != CODEC_LZF) return false;
+
+	size_t raw_size = 0, pos = 2;
+	for (size_t shift = 0; ; shift += 7)
+	{
+		if (pos >= value.size() || shift > 28) return false;
+
+		uint8_t byte = value[pos++];
+		raw_size |= static_cast<size_t>(byte & 0x7f) << shift;
+
+		if (!(byte & 0x80)) break;
+	}
+
+	if (raw_size > MAX_RAW_SIZE) return false;
+
+	return Decompress(value.data() + pos, value.size() - pos, raw_size, out);
+}
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 数据压缩：LZF格式的块压缩(LZ77，最大回溯8KB)，速度优先，用于玩家数据和账号数据存盘.
+ *
+ * 压缩后的数据带头部：0x00 编码方式(1) 原始长度(VARINT)；协议编码的第一个字节不会是0x00(字段号为0非法)，没有头部的按未压缩处理，兼容旧数据.
+ *
+ * */
+
+class Compression
+{
+public:
+	enum CODEC
+	{
+		CODEC_STORED = 0, //未压缩：原始数据以0x00开头时加头部区分
+		CODEC_LZF = 1,
+	};
+public:
+	//块压缩：out为压缩后的数据(不带头部)
+	static void Compress(const char* data, size_t size, std::string& out);
+	//块解压：raw_size为原始长度，数据损坏返回false
+	static bool Decompress(const char* data, size_t size, size_t raw_size, std::string& out);
+
+	//存盘编码：不小于min_size且压缩后更小才压缩，否则保持原样
+	static void Encode(const std::string& value, size_t min_size, std::string& out);
+	//读取解码：没有头部原样返回，数据损坏返回false
+	static bool Decode(const std::string& value, std::string& out);
+	//是否带头部(压缩过)
+	static bool IsEncoded(const std::string& value) { return !value.empty() && value[0] == 0; }
+};
+
+}
@@ -0,0 +1,379 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+
+#include "CurrencyLedger.h"
+#include "AppendLog.h"
+#include "CommonUtil.h"
+#include "Timer.h"
+#include "Config.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+//记录头：校验和(4) 长度(4)，校验和覆盖长度和流水数据
+static const uint64_t LEDGER_HEADER_SIZE = 8;
+
+CurrencyLedger::~CurrencyLedger()
+{
+	Stop();
+
+	if (_fd >= 0) ::close(_fd);
+}
+
+void CurrencyLedger::Encode(const Asset::CurrencyLedger& ledger, std::string& buffer)
+{
+	size_t record_begin = buffer.size();
+
+	buffer.resize(record_begin + LEDGER_HEADER_SIZE);
+	ledger.AppendToString(&buffer);
+
+	uint32_t ledger_size = buffer.size() - record_begin - LEDGER_HEADER_SIZE;
+	std::memcpy(&buffer[record_begin + 4], &ledger_size, 4);
+
+	uint32_t checksum = AppendLog::Checksum(buffer.data() + record_begin + 4, buffer.size() - record_begin - 4);
+	std::memcpy(&buffer[record_begin], &checksum, 4);
+}
+
+bool CurrencyLedger::Load()
+{
+	std::string path = ConfigInstance.GetString("LedgerPath", "ledger.log");
+	int32_t sync_interval = ConfigInstance.GetInt("LedgerSyncInterval", 10);
+	int32_t batch_size = ConfigInstance.GetInt("LedgerBatchSize", 4096);
+	int32_t checkpoint_size = ConfigInstance.GetInt("LedgerCheckpointSize", 64);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_sync_interval = sync_interval > 0 ? sync_interval : 10;
+	_batch_size = batch_size > 0 ? batch_size : 4096;
+	_checkpoint_size = static_cast<uint64_t>(checkpoint_size > 0 ? checkpoint_size : 64) * 1024 * 1024;
+
+	if (_fd >= 0) return true; //重新加载配置，不再恢复
+
+	_path = path;
+
+	_fd = ::open(_path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (_fd < 0)
+	{
+		CP("%s:line:%d open ledger failed, path:%s error:%s", __func__, __LINE__, _path.c_str(), std::strerror(errno));
+		return false;
+	}
+
+	return Recover();
+}
+
+uint64_t CurrencyLedger::Replay(const char* data, uint64_t size)
+{
+	uint64_t pos = 0;
+	Asset::CurrencyLedger ledger;
+
+	while (size - pos >= LEDGER_HEADER_SIZE)
+	{
+		uint32_t checksum = 0, ledger_size = 0;
+
+		std::memcpy(&checksum, data + pos, 4);
+		std::memcpy(&ledger_size, data + pos + 4, 4);
+
+		uint64_t record_size = LEDGER_HEADER_SIZE + ledger_size;
+		if (size - pos < record_size) break; //不完整
+
+		if (AppendLog::Checksum(data + pos + 4, record_size - 4) != checksum) break; //损坏
+
+		if (!ledger.ParseFromArray(data + pos + LEDGER_HEADER_SIZE, ledger_size)) break;
+
+		auto& balance = _balances[ledger.player_id()];
+
+		if (ledger.currency_type() == Asset::CURRENCY_TYPE_DIAMOND) balance.diamond = ledger.balance();
+		else if (ledger.currency_type() == Asset::CURRENCY_TYPE_HUANLEDOU) balance.huanledou = ledger.balance();
+
+		if (ledger.sequence() > _sequence) _sequence = ledger.sequence();
+
+		pos += record_size;
+	}
+
+	return pos;
+}
+
+bool CurrencyLedger::Recover()
+{
+	bool success = AppendLog::Recover(_fd, _path, [this](const char* data, uint64_t size, uint64_t/* offset*/) {
+				return Replay(data, size);
+			}, _end);
+	if (!success) return false;
+
+	_latest = _balances;
+	_checkpoint_end = _end + _checkpoint_size;
+
+	std::cout << __func__ << " ledger recovered, players:" << _balances.size() << ", sequence:" << _sequence << ", bytes:" << _end << std::endl;
+	return true;
+}
+
+void CurrencyLedger::Start()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_thread || _fd < 0) return;
+
+	_stopped = false;
+	_thread = std::make_shared<std::thread>(std::bind(&CurrencyLedger::Run, this));
+}
+
+void CurrencyLedger::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_thread) return;
+
+		_stopped = true;
+	}
+
+	_condition.notify_one();
+	_thread->join();
+	_thread.reset();
+}
+
+void CurrencyLedger::Record(int64_t player_id, Asset::CURRENCY_TYPE currency_type, int64_t count, int64_t balance, Asset::CURRENCY_REASON reason)
+{
+	if (count == 0) return;
+
+	Entry entry;
+	entry.player_id = player_id;
+	entry.currency_type = currency_type;
+	entry.count = count;
+	entry.balance = balance;
+	entry.reason = reason;
+	entry.time = CommonTimerInstance.GetTime();
+
+	bool notify = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		_entries.push_back(entry);
+
+		notify = _entries.size() == _batch_size; //达到批量提前提交
+	}
+
+	if (notify) _condition.notify_one();
+}
+
+bool CurrencyLedger::Restore(int64_t player_id, Asset::CommonProp* common_prop)
+{
+	if (!common_prop) return false;
+
+	Balance balance;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _balances.find(player_id);
+		if (it == _balances.end()) return false;
+
+		balance = it->second;
+		_balances.erase(it); //之后以内存中的数据为准
+	}
+
+	bool restored = false;
+
+	if (balance.diamond >= 0 && balance.diamond != common_prop->diamond())
+	{
+		CP("%s:line:%d player_id:%ld diamond:%ld restored to:%ld", __func__, __LINE__, player_id, common_prop->diamond(), balance.diamond);
+
+		common_prop->set_diamond(balance.diamond);
+		restored = true;
+	}
+
+	if (balance.huanledou >= 0 && balance.huanledou != common_prop->huanledou())
+	{
+		CP("%s:line:%d player_id:%ld huanledou:%ld restored to:%ld", __func__, __LINE__, player_id, common_prop->huanledou(), balance.huanledou);
+
+		common_prop->set_huanledou(balance.huanledou);
+		restored = true;
+	}
+
+	return restored;
+}
+
+void CurrencyLedger::Run()
+{
+	std::vector<Entry> entries;
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true)
+	{
+		_condition.wait_for(lock, std::chrono::milliseconds(_sync_interval), [this]() {
+					return _stopped || _entries.size() >= _batch_size;
+				});
+
+		bool stopped = _stopped;
+
+		if (!_entries.empty())
+		{
+			entries.swap(_entries); //期间所有流水一次提交(GROUP COMMIT)
+
+			uint64_t checkpoint_size = _checkpoint_size;
+			lock.unlock();
+
+			bool success = Commit(entries);
+
+			if (success && _end >= _checkpoint_end)
+			{
+				Checkpoint();
+				_checkpoint_end = _end + checkpoint_size; //失败也等文件再增长后重试
+			}
+
+			lock.lock();
+
+			if (!success) //放回队列头部，保持顺序，下个周期重试
+			{
+				entries.insert(entries.end(), _entries.begin(), _entries.end());
+				_entries.swap(entries);
+			}
+
+			entries.clear();
+
+			if (!success && !stopped) _condition.wait_for(lock, std::chrono::milliseconds(_sync_interval * 10), [this]() { return _stopped; });
+		}
+
+		if (stopped) break;
+	}
+
+	if (!_entries.empty()) CP("%s:line:%d ledger stopped, dropped entries:%lu", __func__, __LINE__, _entries.size());
+}
+
+bool CurrencyLedger::Commit(std::vector<Entry>& entries)
+{
+	auto begin = std::chrono::steady_clock::now();
+
+	//只有提交线程修改文件和流水号，不需要加锁
+	std::string buffer;
+	int64_t sequence = _sequence;
+	Asset::CurrencyLedger ledger;
+
+	for (const auto& entry : entries)
+	{
+		ledger.set_sequence(++sequence);
+		ledger.set_player_id(entry.player_id);
+		ledger.set_currency_type(entry.currency_type);
+		ledger.set_count(entry.count);
+		ledger.set_balance(entry.balance);
+		ledger.set_reason(entry.reason);
+		ledger.set_time(entry.time);
+
+		Encode(ledger, buffer);
+	}
+
+	bool success = AppendLog::Write(_fd, buffer) && ::fdatasync(_fd) == 0;
+
+	if (!success)
+	{
+		CP("%s:line:%d commit ledger failed, entries:%lu error:%s", __func__, __LINE__, entries.size(), std::strerror(errno));
+
+		if (::ftruncate(_fd, _end) != 0) CP("%s:line:%d truncate ledger failed", __func__, __LINE__); //去掉写了一半的流水
+
+		++_failed_total;
+		return false;
+	}
+
+	_end += buffer.size();
+	_sequence = sequence;
+
+	for (const auto& entry : entries)
+	{
+		auto& balance = _latest[entry.player_id];
+
+		if (entry.currency_type == Asset::CURRENCY_TYPE_DIAMOND) balance.diamond = entry.balance;
+		else if (entry.currency_type == Asset::CURRENCY_TYPE_HUANLEDOU) balance.huanledou = entry.balance;
+	}
+
+	int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count();
+
+	++_commit_count;
+	_written_total += entries.size();
+	if (entries.size() > _max_batch) _max_batch = entries.size();
+	if (elapsed > _max_commit_time) _max_commit_time = elapsed;
+
+	return true;
+}
+
+bool CurrencyLedger::Checkpoint()
+{
+	//只有提交线程修改文件，不需要加锁
+	std::string buffer;
+	Asset::CurrencyLedger ledger;
+
+	ledger.set_sequence(_sequence); //恢复时流水号继续递增
+	ledger.set_count(0);
+	ledger.set_reason(Asset::CURRENCY_REASON_CHECKPOINT);
+	ledger.set_time(CommonTimerInstance.GetTime());
+
+	for (const auto& latest : _latest)
+	{
+		ledger.set_player_id(latest.first);
+
+		if (latest.second.diamond >= 0)
+		{
+			ledger.set_currency_type(Asset::CURRENCY_TYPE_DIAMOND);
+			ledger.set_balance(latest.second.diamond);
+			Encode(ledger, buffer);
+		}
+
+		if (latest.second.huanledou >= 0)
+		{
+			ledger.set_currency_type(Asset::CURRENCY_TYPE_HUANLEDOU);
+			ledger.set_balance(latest.second.huanledou);
+			Encode(ledger, buffer);
+		}
+	}
+
+	std::string checkpoint_path = _path + ".checkpoint";
+	std::string archive_path = _path + "." + std::to_string(_sequence); //旧文件保留用于对账
+
+	int fd = ::open(checkpoint_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+
+	//先保留旧文件再替换：任何时刻宕机，当前文件都是完整的(旧文件或者检查点)
+	bool success = fd >= 0 && AppendLog::Write(fd, buffer) && ::fdatasync(fd) == 0 
+		&& ::link(_path.c_str(), archive_path.c_str()) == 0 
+		&& ::rename(checkpoint_path.c_str(), _path.c_str()) == 0;
+
+	if (!success)
+	{
+		CP("%s:line:%d ledger checkpoint failed, error:%s", __func__, __LINE__, std::strerror(errno));
+
+		if (fd >= 0) ::close(fd);
+		::unlink(checkpoint_path.c_str());
+
+		return false;
+	}
+
+	if (!AppendLog::SyncDirectory(_path)) CP("%s:line:%d sync ledger directory failed, error:%s", __func__, __LINE__, std::strerror(errno));
+
+	std::cout << __func__ << " ledger checkpoint, players:" << _latest.size() << ", bytes:" << _end << " -> " << buffer.size() << ", archive:" << archive_path << std::endl;
+
+	::close(_fd);
+	_fd = fd;
+	_end = buffer.size();
+
+	return true;
+}
+
+void CurrencyLedger::Report()
+{
+	size_t pending = 0;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		pending = _entries.size();
+	}
+
+	std::string content = "currency ledger commit_count:" + std::to_string(_commit_count) + " written_total:" + std::to_string(_written_total) +
+		" failed_total:" + std::to_string(_failed_total) + " pending:" + std::to_string(pending) +
+		" max_batch:" + std::to_string(_max_batch) + " max_commit_time:" + std::to_string(_max_commit_time);
+
+	auto log = make_unique<Asset::LogMessage>();
+	log->set_type(Asset::SYSTEM);
+	log->set_content(content);
+
+	LOG(INFO, log.get());
+}
+
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <string>
+#include <vector>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "P_Header.h"
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 货币流水：钻石、欢乐豆的每次变化追加一条记录(数量、余额、原因、时间)，用于对账和宕机恢复.
+ *
+ * 写入：游戏逻辑只放入内存队列，不等待磁盘；提交线程定期把队列中的流水一次写入文件并同步到磁盘(GROUP COMMIT).
+ *
+ * 恢复：启动时顺序读取流水，记录每个玩家最后的余额；玩家加载时以流水中的余额为准(流水同步周期远小于存盘周期).
+ *
+ * 检查点：文件增长到一定大小时，把每个玩家最后的余额写成新文件替换当前文件，旧文件改名保留用于对账，启动时只读取检查点之后的流水.
+ *
+ * 说明：货币只能通过玩家的货币接口修改，不在线修改数据库中的货币会被流水覆盖.
+ *
+ * 配置：
+ *
+ * LedgerPath：流水文件，默认ledger.log.
+ *
+ * LedgerSyncInterval：同步到磁盘的周期(MS)，默认10.
+ *
+ * LedgerBatchSize：队列达到该数量时提前提交，默认4096.
+ *
+ * LedgerCheckpointSize：文件增长超过该大小(MB)时写检查点，默认64.
+ *
+ * */
+
+class CurrencyLedger
+{
+private:
+	struct Entry
+	{
+		int64_t player_id = 0;
+		Asset::CURRENCY_TYPE currency_type = Asset::CURRENCY_TYPE_DIAMOND;
+		int64_t count = 0;
+		int64_t balance = 0;
+		Asset::CURRENCY_REASON reason = Asset::CURRENCY_REASON_UNKNOWN;
+		int64_t time = 0;
+	};
+
+	//启动时恢复的余额，-1为没有流水
+	struct Balance
+	{
+		int64_t diamond = -1;
+		int64_t huanledou = -1;
+	};
+
+	std::string _path;
+	int32_t _sync_interval = 10;
+	size_t _batch_size = 4096;
+	uint64_t _checkpoint_size = 64 * 1024 * 1024;
+
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::shared_ptr<std::thread> _thread;
+	bool _stopped = true;
+	int _fd = -1;
+	uint64_t _end = 0; //文件大小
+	int64_t _sequence = 0; //最后一条流水号
+	uint64_t _checkpoint_end = 0; //文件超过该大小时写检查点
+
+	std::vector<Entry> _entries; //等待提交
+	std::unordered_map<int64_t, Balance> _balances; //玩家加载后移除
+	std::unordered_map<int64_t, Balance> _latest; //每个玩家最后的余额，用于写检查点：只有提交线程访问
+
+	//统计
+	std::atomic<uint64_t> _commit_count{0}; //提交次数
+	std::atomic<uint64_t> _written_total{0}; //写入流水数
+	std::atomic<uint64_t> _failed_total{0}; //提交失败次数
+	std::atomic<uint64_t> _max_batch{0}; //单次提交最多流水数
+	std::atomic<int64_t> _max_commit_time{0}; //最长提交耗时(MS)
+private:
+	static void Encode(const Asset::CurrencyLedger& ledger, std::string& buffer); //追加一条记录
+
+	//解析流水，更新余额，返回有效数据的长度(末尾不完整的记录之前)
+	uint64_t Replay(const char* data, uint64_t size);
+	bool Recover();
+
+	void Run(); //提交线程
+	bool Commit(std::vector<Entry>& entries); //写入并同步，失败时文件恢复原样
+	bool Checkpoint(); //写入所有玩家的余额，替换当前文件
+public:
+	static CurrencyLedger& Instance()
+	{
+		static CurrencyLedger _instance;
+		return _instance;
+	}
+
+	~CurrencyLedger();
+
+	//读取配置，恢复余额
+	bool Load();
+	void Start();
+	//停止提交线程：写完队列中的流水后返回
+	void Stop();
+
+	//记录流水：count增加为正，消耗为负；balance为变化后的余额
+	void Record(int64_t player_id, Asset::CURRENCY_TYPE currency_type, int64_t count, int64_t balance, Asset::CURRENCY_REASON reason);
+
+	//玩家加载：以流水中的余额为准，返回是否修正
+	bool Restore(int64_t player_id, Asset::CommonProp* common_prop);
+
+	//统计日志
+	void Report();
+};
+
+#define LedgerInstance CurrencyLedger::Instance()
+
+}
@@ -0,0 +1,184 @@
+#include <sstream>
+#include <algorithm>
+#include <iostream>
+
+#include "FloodControl.h"
+#include "CommonUtil.h"
+#include "Config.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+void TokenBucket::Refill(const FloodRule& rule, int64_t curr_time)
+{
+	int64_t capacity = int64_t(rule.burst) * 1000;
+
+	if (_tokens < 0) 
+	{
+		_tokens = capacity;
+		_last_time = curr_time;
+		return;
+	}
+
+	int64_t elapsed = curr_time - _last_time;
+	if (elapsed <= 0) return;
+
+	_tokens += elapsed * rule.rate; //每MS补充rate/1000个令牌
+	if (_tokens > capacity) _tokens = capacity;
+
+	_last_time = curr_time;
+}
+
+int64_t TokenBucket::Wait(const FloodRule& rule) const
+{
+	if (_tokens >= 1000) return 0;
+	if (rule.rate <= 0) return 1000;
+
+	return (1000 - _tokens + rule.rate - 1) / rule.rate;
+}
+
+FloodControlManager::FloodControlManager() : _throttled_total(0)
+{
+	for (auto& throttled : _throttled) throttled = 0;
+}
+
+void FloodControlManager::Load()
+{
+	_session_rule.rate = ConfigInstance.GetInt("FloodControlRate", 0);
+	_session_rule.burst = ConfigInstance.GetInt("FloodControlBurst", _session_rule.rate * 2);
+	if (_session_rule.burst < _session_rule.rate) _session_rule.burst = _session_rule.rate;
+
+	std::string action = ConfigInstance.GetString("FloodControlAction", "delay");
+	if (action == "drop") _action = FLOOD_ACTION_DROP;
+	else if (action == "disconnect") _action = FLOOD_ACTION_DISCONNECT;
+	else _action = FLOOD_ACTION_DELAY;
+
+	_type_rules.clear();
+	_type_slots.assign(Asset::META_TYPE_C2S_COUNT + 1, -1);
+
+	std::string value;
+	std::stringstream types(ConfigInstance.GetString("FloodControlTypes", ""));
+	while (std::getline(types, value, ','))
+	{
+		std::vector<std::string> fields;
+		std::stringstream stream(value);
+		std::string field;
+		while (std::getline(stream, field, ':')) fields.push_back(field);
+
+		if (fields.size() < 2) continue;
+
+		int32_t type_t = 0;
+		const pb::EnumValueDescriptor* enum_value = Asset::META_TYPE_descriptor()->FindValueByName(fields[0]); //支持协议名称
+		if (enum_value) type_t = enum_value->number();
+		else type_t = std::atoi(fields[0].c_str());
+
+		if (type_t <= 0 || type_t >= (int32_t)_type_slots.size()) 
+		{
+			std::cout << __func__ << ":invalid flood control type:" << fields[0] << std::endl;
+			continue;
+		}
+
+		FloodRule rule;
+		rule.rate = std::atoi(fields[1].c_str());
+		rule.burst = fields.size() > 2 ? std::atoi(fields[2].c_str()) : rule.rate;
+		if (rule.rate <= 0) continue;
+		if (rule.burst < 1) rule.burst = 1;
+
+		if (_type_slots[type_t] >= 0) 
+		{
+			_type_rules[_type_slots[type_t]] = rule;
+			continue;
+		}
+
+		_type_slots[type_t] = _type_rules.size();
+		_type_rules.push_back(rule);
+	}
+
+	std::cout << __func__ << ":flood control session rate:" << _session_rule.rate << " burst:" << _session_rule.burst 
+		<< " types:" << _type_rules.size() << " action:" << _action << std::endl;
+}
+
+void FloodControlManager::OnThrottled(int32_t type_t)
+{
+	++_throttled_total;
+
+	if (type_t > 0 && type_t < Asset::META_TYPE_ARRAYSIZE) ++_throttled[type_t];
+}
+
+uint64_t FloodControlManager::GetThrottled(int32_t type_t) const
+{
+	if (type_t <= 0 || type_t >= Asset::META_TYPE_ARRAYSIZE) return 0;
+
+	return _throttled[type_t];
+}
+
+void FloodControlManager::Report()
+{
+	uint64_t total = _throttled_total;
+	if (total == _reported_total) return;
+
+	_reported_total = total;
+
+	std::string content = "flood control throttled total:" + std::to_string(total);
+
+	for (int32_t type_t = 1; type_t < Asset::META_TYPE_ARRAYSIZE; ++type_t)
+	{
+		uint64_t count = _throttled[type_t];
+		if (count == 0) continue;
+
+		const pb::EnumValueDescriptor* enum_value = Asset::META_TYPE_descriptor()->FindValueByNumber(type_t);
+		content += " " + (enum_value ? enum_value->name() : std::to_string(type_t)) + ":" + std::to_string(count);
+	}
+
+	auto log = make_unique<Asset::LogMessage>();
+	log->set_type(Asset::SYSTEM);
+	log->set_content(content);
+
+	LOG(WARNNING, log.get());
+}
+
+FLOOD_ACTION FloodControl::Check(int32_t type_t, int64_t& wait_time)
+{
+	wait_time = 0;
+
+	const auto& session_rule = FloodControlInstance.GetSessionRule();
+	int32_t slot = FloodControlInstance.GetTypeSlot(type_t);
+
+	if (session_rule.rate <= 0 && slot < 0) return FLOOD_ACTION_NONE; //不限制
+
+	int64_t curr_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	if (session_rule.rate > 0)
+	{
+		_session_bucket.Refill(session_rule, curr_time);
+		wait_time = _session_bucket.Wait(session_rule);
+	}
+
+	TokenBucket* type_bucket = nullptr;
+
+	if (slot >= 0)
+	{
+		if (_type_buckets.size() < FloodControlInstance.GetTypeCount()) _type_buckets.resize(FloodControlInstance.GetTypeCount());
+
+		const auto& type_rule = FloodControlInstance.GetTypeRule(slot);
+
+		type_bucket = &_type_buckets[slot];
+		type_bucket->Refill(type_rule, curr_time);
+		wait_time = std::max(wait_time, type_bucket->Wait(type_rule));
+	}
+
+	if (wait_time > 0) //超出限制
+	{
+		++_throttled_count;
+		FloodControlInstance.OnThrottled(type_t);
+		return FloodControlInstance.GetAction();
+	}
+
+	if (session_rule.rate > 0) _session_bucket.Consume();
+	if (type_bucket) type_bucket->Consume();
+
+	return FLOOD_ACTION_NONE;
+}
+
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <chrono>
+
+#include "P_Header.h"
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 流量控制：每个会话一个总的令牌桶，配置了的协议类型每种一个令牌桶.
+ *
+ * 在协议解析之前检查，超出限制的包按配置丢弃、延迟处理或断开连接.
+ *
+ * 配置：
+ *
+ * FloodControlRate：每个会话每秒协议数，0为不限制；FloodControlBurst：突发上限.
+ *
+ * FloodControlTypes：协议类型限制，格式为"协议名:每秒数量:突发上限"，逗号分隔.
+ *
+ * FloodControlAction：超出限制的处理，drop/delay/disconnect，默认为delay.
+ *
+ * */
+
+enum FLOOD_ACTION
+{
+	FLOOD_ACTION_NONE = 0, //没有超出
+	FLOOD_ACTION_DROP = 1, //丢弃
+	FLOOD_ACTION_DELAY = 2, //延迟处理
+	FLOOD_ACTION_DISCONNECT = 3, //断开连接
+};
+
+//限制规则
+struct FloodRule
+{
+	int32_t rate = 0; //每秒数量
+	int32_t burst = 0; //突发上限
+};
+
+//令牌桶：千分之一个令牌为单位，不用浮点
+class TokenBucket
+{
+	int64_t _tokens = -1; //首次使用时装满
+	int64_t _last_time = 0; //上次补充时间(MS)
+public:
+	void Refill(const FloodRule& rule, int64_t curr_time);
+	//是否有令牌，没有则返回需要等待的时间(MS)
+	int64_t Wait(const FloodRule& rule) const;
+	void Consume() { _tokens -= 1000; }
+};
+
+class FloodControlManager
+{
+private:
+	FLOOD_ACTION _action = FLOOD_ACTION_DELAY;
+	FloodRule _session_rule; //会话总限制
+	std::vector<FloodRule> _type_rules; //协议类型限制
+	std::vector<int32_t> _type_slots; //协议类型对应的令牌桶位置，-1为不限制
+
+	//统计：超出限制的次数
+	std::atomic<uint64_t> _throttled[Asset::META_TYPE_ARRAYSIZE]; 
+	std::atomic<uint64_t> _throttled_total;
+	uint64_t _reported_total = 0;
+public:
+	FloodControlManager();
+
+	static FloodControlManager& Instance()
+	{
+		static FloodControlManager _instance;
+		return _instance;
+	}
+
+	//读取配置：启动时调用
+	void Load();
+
+	bool IsEnabled() const { return _session_rule.rate > 0 || _type_rules.size() > 0; }
+	FLOOD_ACTION GetAction() const { return _action; }
+	const FloodRule& GetSessionRule() const { return _session_rule; }
+	size_t GetTypeCount() const { return _type_rules.size(); }
+	int32_t GetTypeSlot(int32_t type_t) const 
+	{
+		if (type_t <= 0 || type_t >= (int32_t)_type_slots.size()) return -1;
+		return _type_slots[type_t];
+	}
+	const FloodRule& GetTypeRule(int32_t slot) const { return _type_rules[slot]; }
+
+	void OnThrottled(int32_t type_t);
+	uint64_t GetThrottled(int32_t type_t) const;
+	uint64_t GetThrottledTotal() const { return _throttled_total; }
+	//输出统计：有变化才输出
+	void Report();
+};
+
+#define FloodControlInstance FloodControlManager::Instance()
+
+//会话流量控制
+class FloodControl
+{
+private:
+	TokenBucket _session_bucket;
+	std::vector<TokenBucket> _type_buckets;
+	uint64_t _throttled_count = 0; //超出限制次数
+public:
+	//检查一个包：wait_time返回需要等待的时间(MS)
+	FLOOD_ACTION Check(int32_t type_t, int64_t& wait_time);
+
+	uint64_t GetThrottledCount() const { return _throttled_count; }
+};
+
+}
@@ -43,8 +43,7 @@ bool Game::Start(std::vector<std::shared_ptr<Player>> players)
 
 	for (auto player : players)
 	{
-		_players[player_index++] = player; //复制成员
-		player->SetPosition(Asset::POSITION_TYPE(player_index));
+		_players[player_index++] = player; //复制成员：座次与房间中的座位顺序相同
 	}
 
 	_banker_index = _room->GetBankerIndex();
@@ -594,6 +593,8 @@ bool GameManager::Load()
 
 void GameManager::OnCreateGame(std::shared_ptr<Game> game)
 {
+	std::lock_guard<std::mutex> lock(_mutex);
+
 	_games.push_back(game);
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <list>
+#include <mutex>
 #include <memory>
 #include <vector>
 #include <numeric>
@@ -61,8 +62,11 @@ public:
 	std::shared_ptr<Player> GetPlayerByOrder(int32_t player_index);
 	//获取玩家的顺序
 	int32_t GetPlayerOrder(int32_t player_id);
+	//玩家座次：开局时的顺序+1
+	Asset::POSITION_TYPE GetPosition(int64_t player_id) { return Asset::POSITION_TYPE(GetPlayerOrder(player_id) + 1); }
 	//设置房间
 	void SetRoom(std::shared_ptr<Room> room) {	_room = room; }
+	std::shared_ptr<Room> GetRoom() { return _room; }
 };
 
 /////////////////////////////////////////////////////
@@ -72,6 +76,7 @@ class GameManager
 {
 private:
 	std::unordered_map<int32_t/*牌索引*/, Asset::PaiElement/*牌值*/> _cards;
+	std::mutex _mutex; //游戏在各个房间邮箱中创建
 	std::vector<shared_ptr<Game>> _games;
 public:
 	static GameManager& Instance()
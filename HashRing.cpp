@@ -0,0 +1,52 @@
+#include <algorithm>
+
+#include "HashRing.h"
+
+namespace Adoter
+{
+
+uint64_t HashRing::Hash(const std::string& key)
+{
+	uint64_t hash = 14695981039346656037ull; //FNV-1a
+
+	for (unsigned char c : key)
+	{
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+
+	//混合：相近的键(player:1、player:2)分散到整个环上
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+void HashRing::Build(const std::vector<std::string>& names, size_t replicas)
+{
+	_points.clear();
+	_points.reserve(names.size() * replicas);
+	_count = names.size();
+
+	for (size_t index = 0; index < names.size(); ++index)
+	{
+		for (size_t i = 0; i < replicas; ++i) _points.emplace_back(Hash(names[index] + "#" + std::to_string(i)), index);
+	}
+
+	std::sort(_points.begin(), _points.end());
+}
+
+size_t HashRing::Get(const std::string& key) const
+{
+	if (_points.empty()) return 0;
+
+	auto it = std::lower_bound(_points.begin(), _points.end(), std::make_pair(Hash(key), static_cast<size_t>(0)));
+	if (it == _points.end()) it = _points.begin(); //环：回到开头
+
+	return it->second;
+}
+
+}
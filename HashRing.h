@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 一致性哈希：每个节点按名称在环上放若干虚拟节点，键落在顺时针方向的第一个虚拟节点上.
+ *
+ * 增加一个节点只有约1/N的键改变归属(都移到新节点)，其余键不变；节点位置只和名称有关，与配置顺序无关.
+ *
+ * */
+
+class HashRing
+{
+private:
+	std::vector<std::pair<uint64_t, size_t>> _points; //虚拟节点：哈希值 -> 节点索引，按哈希值排序
+	size_t _count = 0;
+public:
+	//稳定的哈希：不同机器、不同版本结果相同
+	static uint64_t Hash(const std::string& key);
+
+	//建环：names为节点名称，replicas为每个节点的虚拟节点数
+	void Build(const std::vector<std::string>& names, size_t replicas = 1024);
+
+	//键所在的节点索引，没有节点返回0
+	size_t Get(const std::string& key) const;
+
+	size_t Size() const { return _count; }
+};
+
+}
@@ -0,0 +1,188 @@
+#include "IdAllocator.h"
+#include "Storage.h"
+#include "Config.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+IdAllocator::IdAllocator(ID_TYPE type) : _type(type)
+{
+	auto& shared = GetShared();
+
+	std::lock_guard<std::mutex> lock(shared.mutex);
+	_block_size = shared.block_size;
+}
+
+IdAllocator& IdAllocator::Instance(ID_TYPE type)
+{
+	static thread_local std::unique_ptr<IdAllocator> _instances[ID_TYPE_COUNT];
+
+	auto& instance = _instances[type];
+	if (!instance) instance.reset(new IdAllocator(type));
+
+	return *instance;
+}
+
+IdAllocator::Shared& IdAllocator::GetShared()
+{
+	static Shared _shared;
+	return _shared;
+}
+
+const std::string& IdAllocator::GetKey(ID_TYPE type)
+{
+	//与原来INCR的计数器相同，已经分配的ID不会重复
+	static const std::string keys[ID_TYPE_COUNT] = { "player_counter", "room_counter" };
+	return keys[type];
+}
+
+bool IdAllocator::LeaseBlocks(ID_TYPE type, size_t count, int64_t block_size, std::deque<Block>& blocks)
+{
+	int64_t end = StorageInstance.IncrBy(GetKey(type), block_size * count);
+
+	if (end <= 0) 
+	{
+		CP("%s:line:%d lease id block failed, key:%s", __func__, __LINE__, GetKey(type).c_str());
+		return false;
+	}
+
+	int64_t begin = end - block_size * count + 1;
+	for (size_t i = 0; i < count; ++i, begin += block_size) blocks.emplace_back(begin, begin + block_size);
+
+	return true;
+}
+
+bool IdAllocator::Load(size_t thread_count)
+{
+	auto& shared = GetShared();
+
+	int64_t block_size = ConfigInstance.GetInt("IdBlockSize", 100);
+	if (block_size <= 0) block_size = 1;
+
+	std::lock_guard<std::mutex> lock(shared.mutex);
+
+	if (shared.thread) return true; //已经启动
+
+	shared.block_size = block_size;
+	shared.spare_blocks = thread_count > 2 ? thread_count : 2;
+
+	for (int32_t i = 0; i < ID_TYPE_COUNT; ++i)
+	{
+		auto& pool = shared.pools[i];
+		if (pool.size() >= shared.spare_blocks) continue;
+
+		if (!LeaseBlocks(static_cast<ID_TYPE>(i), shared.spare_blocks - pool.size(), block_size, pool)) return false;
+	}
+
+	shared.stopped = false;
+	shared.thread = std::make_shared<std::thread>(&IdAllocator::Run);
+
+	return true;
+}
+
+void IdAllocator::Stop()
+{
+	auto& shared = GetShared();
+
+	{
+		std::lock_guard<std::mutex> lock(shared.mutex);
+		if (!shared.thread) return;
+
+		shared.stopped = true;
+	}
+
+	shared.condition.notify_one();
+	shared.thread->join();
+	shared.thread.reset();
+}
+
+void IdAllocator::Run()
+{
+	auto& shared = GetShared();
+	std::unique_lock<std::mutex> lock(shared.mutex);
+
+	while (!shared.stopped)
+	{
+		bool failed = false;
+
+		for (int32_t i = 0; i < ID_TYPE_COUNT && !shared.stopped; ++i)
+		{
+			size_t size = shared.pools[i].size();
+			if (size >= shared.spare_blocks) continue;
+
+			size_t count = shared.spare_blocks - size;
+			int64_t block_size = shared.block_size;
+
+			lock.unlock();
+
+			std::deque<Block> blocks;
+			bool success = LeaseBlocks(static_cast<ID_TYPE>(i), count, block_size, blocks); //一次往返补足
+
+			lock.lock();
+
+			if (success) shared.pools[i].insert(shared.pools[i].end(), blocks.begin(), blocks.end());
+			else failed = true;
+		}
+
+		//段池取走时唤醒；数据库失败时稍后重试
+		shared.condition.wait_for(lock, std::chrono::seconds(failed ? 1 : 10), [&shared, failed]() {
+					if (shared.stopped) return true;
+					if (failed) return false;
+
+					for (const auto& pool : shared.pools)
+					{
+						if (pool.size() < shared.spare_blocks) return true;
+					}
+
+					return false;
+				});
+	}
+}
+
+bool IdAllocator::TakeBlock(Block& block)
+{
+	auto& shared = GetShared();
+	bool success = false;
+
+	{
+		std::lock_guard<std::mutex> lock(shared.mutex);
+
+		auto& pool = shared.pools[_type];
+		if (!pool.empty())
+		{
+			block = pool.front();
+			pool.pop_front();
+
+			success = true;
+		}
+	}
+
+	shared.condition.notify_one(); //补充段池
+
+	return success;
+}
+
+int64_t IdAllocator::Allocate()
+{
+	if (_next >= _end)
+	{
+		if (_prefetched.first >= _prefetched.second && !TakeBlock(_prefetched))
+		{
+			CP("%s:line:%d no id block available, key:%s", __func__, __LINE__, GetKey(_type).c_str());
+			return 0; //段池为空：不等待数据库
+		}
+
+		_next = _prefetched.first;
+		_end = _prefetched.second;
+		_prefetched = Block(0, 0);
+	}
+
+	int64_t id = _next++;
+
+	if (_end - _next <= _block_size / 2 && _prefetched.first >= _prefetched.second) TakeBlock(_prefetched); //用掉一半，预取下一段
+
+	return id;
+}
+
+}
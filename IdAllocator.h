@@ -0,0 +1,87 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <string>
+#include <cstdint>
+#include <utility>
+
+namespace Adoter
+{
+
+enum ID_TYPE
+{
+	ID_TYPE_PLAYER = 0, //角色ID
+	ID_TYPE_ROOM = 1, //房间ID
+	ID_TYPE_COUNT = 2,
+};
+
+/*
+ * 类说明：
+ *
+ * ID分配：从数据库一次租用一段ID(INCRBY)，在本地逐个分配，不再每个ID访问一次数据库.
+ *
+ * 每个线程独立分配，不加锁；当前段用掉一半时从共享的段池预取下一段，用完直接切换.
+ *
+ * 段池：启动时按网络和世界线程数同步租用，之后由单独的租用线程补充，网络和世界线程从不访问数据库.
+ *
+ * 段池为空(数据库不可用或者补充还没完成)时分配失败，不等待，由调用者提示客户端.
+ *
+ * 配置：IdBlockSize，每次租用的数量，默认100.
+ *
+ * 说明：ID全局唯一但不连续，停服时未用完的ID丢弃.
+ *
+ * */
+
+class IdAllocator
+{
+private:
+	typedef std::pair<int64_t, int64_t> Block; //[开始, 结束)
+
+	//所有线程共享：段池和租用线程
+	struct Shared
+	{
+		std::mutex mutex;
+		std::condition_variable condition;
+		std::shared_ptr<std::thread> thread;
+		bool stopped = false;
+		size_t spare_blocks = 2; //每种ID段池保留的数量：每个线程一段
+		int64_t block_size = 100;
+		std::deque<Block> pools[ID_TYPE_COUNT];
+	};
+
+	ID_TYPE _type;
+	int64_t _next = 0; //下一个分配的ID
+	int64_t _end = 0; //当前段结束(不包含)
+	int64_t _block_size = 0;
+	Block _prefetched{0, 0}; //预取的下一段
+private:
+	static Shared& GetShared();
+	static const std::string& GetKey(ID_TYPE type);
+	static bool LeaseBlocks(ID_TYPE type, size_t count, int64_t block_size, std::deque<Block>& blocks); //一次租用多段
+	static void Run(); //租用线程
+
+	bool TakeBlock(Block& block); //从段池取一段，不等待
+public:
+	explicit IdAllocator(ID_TYPE type);
+
+	IdAllocator(IdAllocator const& right) = delete;
+	IdAllocator& operator=(IdAllocator const& right) = delete;
+
+	//启动：按线程数租用第一批段，启动租用线程；thread_count为会分配ID的线程数
+	static bool Load(size_t thread_count);
+	static void Stop();
+
+	//分配ID，失败为0(段池为空时不等待)
+	int64_t Allocate();
+
+	//当前线程的分配器
+	static IdAllocator& Instance(ID_TYPE type);
+};
+
+#define IdAllocatorInstance(type) IdAllocator::Instance(type)
+
+}
@@ -0,0 +1,652 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+#include "LogStorage.h"
+#include "AppendLog.h"
+#include "Config.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+//记录头：校验和(4) 类型(1) 键长度(4) 值长度(4)，校验和覆盖头部之后的所有内容
+static const uint64_t RECORD_HEADER_SIZE = 13;
+
+LogStorage::LogStorage()
+{
+	_path = ConfigInstance.GetString("StorageLogPath", "storage.log");
+
+	int32_t sync_interval = ConfigInstance.GetInt("StorageLogSyncInterval", 10);
+	_sync_interval = sync_interval > 0 ? sync_interval : 10;
+
+	int32_t compact_ratio = ConfigInstance.GetInt("StorageLogCompactRatio", 3);
+	_compact_ratio = compact_ratio > 1 ? compact_ratio : 3;
+
+	int32_t compact_min_size = ConfigInstance.GetInt("StorageLogCompactMinSize", 64);
+	_compact_min_size = static_cast<uint64_t>(compact_min_size > 0 ? compact_min_size : 64) * 1024 * 1024;
+}
+
+LogStorage::~LogStorage()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopped = true;
+	}
+
+	_commit_condition.notify_all();
+	_synced_condition.notify_all();
+
+	if (_commit_thread) _commit_thread->join(); //最后一次同步
+	if (_compact_thread) _compact_thread->join();
+
+	if (_fd >= 0) ::close(_fd);
+}
+
+void LogStorage::EncodeRecord(RECORD_TYPE type, const std::string& key, const std::string& value, std::string& record)
+{
+	uint8_t record_type = type;
+	uint32_t key_size = key.size();
+	uint32_t value_size = value.size();
+
+	record.resize(RECORD_HEADER_SIZE);
+	std::memcpy(&record[4], &record_type, 1);
+	std::memcpy(&record[5], &key_size, 4);
+	std::memcpy(&record[9], &value_size, 4);
+	record += key;
+	record += value;
+
+	uint32_t checksum = AppendLog::Checksum(record.data() + 4, record.size() - 4);
+	std::memcpy(&record[0], &checksum, 4);
+}
+
+uint64_t LogStorage::Replay(const char* data, uint64_t size, uint64_t base_offset, ValueIndex& values, PlayerIndex& players, uint64_t& live_bytes)
+{
+	uint64_t pos = 0;
+
+	while (size - pos >= RECORD_HEADER_SIZE)
+	{
+		uint32_t checksum = 0, key_size = 0, value_size = 0;
+		uint8_t type = 0;
+
+		std::memcpy(&checksum, data + pos, 4);
+		std::memcpy(&type, data + pos + 4, 1);
+		std::memcpy(&key_size, data + pos + 5, 4);
+		std::memcpy(&value_size, data + pos + 9, 4);
+
+		uint64_t record_size = RECORD_HEADER_SIZE + key_size + value_size;
+		if (size - pos < record_size) break; //不完整
+
+		if (AppendLog::Checksum(data + pos + 4, record_size - 4) != checksum) break; //损坏
+
+		const char* key = data + pos + RECORD_HEADER_SIZE;
+		const char* value = key + key_size;
+		uint64_t value_offset = base_offset + pos + RECORD_HEADER_SIZE + key_size;
+
+		if (type == RECORD_TYPE_VALUE)
+		{
+			Location& location = values[std::string(key, key_size)];
+			live_bytes -= location.size;
+
+			location.offset = value_offset;
+			location.size = value_size;
+			live_bytes += value_size;
+		}
+		else if (type == RECORD_TYPE_PLAYER && key_size == sizeof(int64_t))
+		{
+			int64_t player_id = 0;
+			std::memcpy(&player_id, key, sizeof(player_id));
+
+			auto& sections = players[player_id];
+
+			//段：名称长度(4) 名称 数据长度(4) 数据
+			uint64_t p = 0;
+			while (value_size - p >= 8)
+			{
+				uint32_t name_size = 0, section_size = 0;
+				std::memcpy(&name_size, value + p, 4);
+				if (value_size - p - 8 < name_size) break;
+
+				std::memcpy(&section_size, value + p + 4 + name_size, 4);
+				if (value_size - p - 8 - name_size < section_size) break;
+
+				Location& location = sections[std::string(value + p + 4, name_size)];
+				live_bytes -= location.size;
+
+				location.offset = value_offset + p + 8 + name_size;
+				location.size = section_size;
+				live_bytes += section_size;
+
+				p += 8 + name_size + section_size;
+			}
+		}
+		else
+		{
+			break; //未知类型，按损坏处理
+		}
+
+		pos += record_size;
+	}
+
+	return pos;
+}
+
+bool LogStorage::Load()
+{
+	_fd = ::open(_path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+	if (_fd < 0)
+	{
+		CP("%s:line:%d open storage log failed, path:%s error:%s", __func__, __LINE__, _path.c_str(), std::strerror(errno));
+		return false;
+	}
+
+	if (!Recover()) return false;
+
+	_commit_thread = std::make_shared<std::thread>(std::bind(&LogStorage::Commit, this));
+	return true;
+}
+
+bool LogStorage::Recover()
+{
+	bool success = AppendLog::Recover(_fd, _path, [this](const char* data, uint64_t size, uint64_t offset) {
+				return Replay(data, size, offset, _values, _players, _live_bytes);
+			}, _end);
+	if (!success) return false;
+
+	std::cout << __func__ << " storage log recovered, keys:" << _values.size() + _players.size() << ", bytes:" << _end << std::endl;
+	return true;
+}
+
+uint64_t LogStorage::Append(RECORD_TYPE type, const std::string& key, const std::string& value)
+{
+	if (_fd < 0) return 0;
+
+	std::string record;
+	EncodeRecord(type, key, value, record);
+
+	if (!AppendLog::Write(_fd, record))
+	{
+		CP("%s:line:%d write storage log failed, error:%s", __func__, __LINE__, std::strerror(errno));
+
+		if (::ftruncate(_fd, _end) != 0) CP("%s:line:%d truncate storage log failed", __func__, __LINE__); //去掉写了一半的记录
+		return 0;
+	}
+
+	Replay(record.data(), record.size(), _end, _values, _players, _live_bytes); //和启动时同样的方式更新索引
+
+	_end += record.size();
+	_written += record.size();
+
+	return _written;
+}
+
+bool LogStorage::ReadLocked(const Location& location, std::string& value)
+{
+	value.resize(location.size);
+
+	size_t read = 0;
+	while (read < location.size)
+	{
+		ssize_t bytes = ::pread(_fd, &value[read], location.size - read, location.offset + read);
+		if (bytes < 0 && errno == EINTR) continue;
+		if (bytes <= 0) return false;
+
+		read += bytes;
+	}
+
+	return true;
+}
+
+bool LogStorage::GetValue(const std::string& key, std::string& value)
+{
+	value.clear();
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto it = _values.find(key);
+	if (it == _values.end()) return true; //没有数据
+
+	return ReadLocked(it->second, value);
+}
+
+uint64_t LogStorage::SetValue(const std::string& key, const std::string& value)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return Append(RECORD_TYPE_VALUE, key, value);
+}
+
+uint64_t LogStorage::SetPlayer(int64_t player_id, const PlayerSections& sections)
+{
+	std::string key(reinterpret_cast<const char*>(&player_id), sizeof(player_id));
+
+	std::string value;
+	for (const auto& section : sections)
+	{
+		uint32_t name_size = section.first.size();
+		uint32_t section_size = section.second.size();
+
+		value.append(reinterpret_cast<const char*>(&name_size), 4);
+		value += section.first;
+		value.append(reinterpret_cast<const char*>(&section_size), 4);
+		value += section.second;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	return Append(RECORD_TYPE_PLAYER, key, value);
+}
+
+PlayerRecord LogStorage::GetPlayer(int64_t player_id)
+{
+	PlayerRecord record;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto it = _players.find(player_id);
+	if (it == _players.end())
+	{
+		record.success = true; //没有数据
+		return record;
+	}
+
+	for (const auto& section : it->second)
+	{
+		std::string& data = record.sections[section.first];
+		if (!ReadLocked(section.second, data)) return record;
+
+		record.stuff += data;
+	}
+
+	record.success = true;
+	return record;
+}
+
+bool LogStorage::WaitSynced(uint64_t written)
+{
+	if (written == 0) return false;
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_synced_condition.wait(lock, [this, written]() { return _synced >= written || _stopped; });
+
+	return _synced >= written;
+}
+
+void LogStorage::Complete(boost::asio::io_service& io_service, uint64_t written, std::function<void()> task)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (written == 0 || _synced >= written)
+	{
+		io_service.post(task);
+		return;
+	}
+
+	Completion completion;
+	completion.written = written;
+	completion.io_service = &io_service;
+	completion.task = std::move(task);
+
+	_completions.push_back(std::move(completion));
+}
+
+bool LogStorage::NeedCompact()
+{
+	if (_compacting || _stopped) return false;
+
+	return _end > _compact_min_size && _end > _live_bytes * _compact_ratio;
+}
+
+void LogStorage::Commit()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (true)
+	{
+		_commit_condition.wait_for(lock, std::chrono::milliseconds(_sync_interval), [this]() { return _stopped; });
+
+		bool stopped = _stopped;
+
+		if (_written > _synced) //期间所有写入一次同步(GROUP COMMIT)
+		{
+			uint64_t written = _written;
+			int fd = _fd;
+			bool directory_dirty = _directory_dirty;
+
+			_syncing = true;
+			lock.unlock();
+
+			bool success = ::fdatasync(fd) == 0 && (!directory_dirty || AppendLog::SyncDirectory(_path));
+
+			lock.lock();
+			_syncing = false;
+
+			if (success) _directory_dirty = false;
+
+			if (success && written > _synced) _synced = written;
+			if (!success) CP("%s:line:%d sync storage log failed, error:%s", __func__, __LINE__, std::strerror(errno));
+
+			_synced_condition.notify_all();
+		}
+
+		//已同步的写入回调
+		auto it = std::partition(_completions.begin(), _completions.end(), [this](const Completion& completion) {
+					return completion.written > _synced;
+				});
+		for (auto ready = it; ready != _completions.end(); ++ready) ready->io_service->post(std::move(ready->task));
+		_completions.erase(it, _completions.end());
+
+		if (stopped) break;
+
+		if (NeedCompact())
+		{
+			_compacting = true;
+
+			auto compact_thread = _compact_thread; //上一次整理已经结束
+			lock.unlock();
+
+			if (compact_thread) compact_thread->join();
+			compact_thread = std::make_shared<std::thread>(std::bind(&LogStorage::Compact, this));
+
+			lock.lock();
+			_compact_thread = compact_thread;
+		}
+	}
+}
+
+void LogStorage::Compact()
+{
+	ValueIndex values;
+	PlayerIndex players;
+	uint64_t snapshot_end = 0;
+	int fd = -1;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		values = _values;
+		players = _players;
+		snapshot_end = _end;
+		fd = _fd; //只有整理线程替换文件，整理期间不变
+	}
+
+	std::string compact_path = _path + ".compact";
+	int compact_fd = ::open(compact_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+
+	ValueIndex compact_values;
+	PlayerIndex compact_players;
+	uint64_t compact_live_bytes = 0;
+	uint64_t compact_end = 0;
+
+	std::string buffer, record;
+	bool success = compact_fd >= 0;
+
+	//写入一条记录，同时建立新文件的索引
+	auto write_record = [&](RECORD_TYPE type, const std::string& key, const std::string& value) {
+		EncodeRecord(type, key, value, record);
+		Replay(record.data(), record.size(), compact_end, compact_values, compact_players, compact_live_bytes);
+
+		compact_end += record.size();
+		buffer += record;
+
+		if (buffer.size() < 4 * 1024 * 1024) return;
+
+		success = success && ::write(compact_fd, buffer.data(), buffer.size()) == static_cast<ssize_t>(buffer.size());
+		buffer.clear();
+	};
+
+	//读取旧文件：只追加，已有数据的位置不变，不需要加锁
+	auto read_value = [&](const Location& location, std::string& value) {
+		value.resize(location.size);
+		success = success && ::pread(fd, &value[0], location.size, location.offset) == static_cast<ssize_t>(location.size);
+	};
+
+	std::string value;
+	for (auto it = values.begin(); success && it != values.end(); ++it)
+	{
+		read_value(it->second, value);
+		write_record(RECORD_TYPE_VALUE, it->first, value);
+	}
+
+	for (auto it = players.begin(); success && it != players.end(); ++it)
+	{
+		value.clear();
+		for (const auto& section : it->second)
+		{
+			std::string data;
+			read_value(section.second, data);
+
+			uint32_t name_size = section.first.size();
+			uint32_t section_size = data.size();
+
+			value.append(reinterpret_cast<const char*>(&name_size), 4);
+			value += section.first;
+			value.append(reinterpret_cast<const char*>(&section_size), 4);
+			value += data;
+		}
+
+		int64_t player_id = it->first;
+		write_record(RECORD_TYPE_PLAYER, std::string(reinterpret_cast<const char*>(&player_id), sizeof(player_id)), value);
+	}
+
+	if (success && buffer.size()) success = ::write(compact_fd, buffer.data(), buffer.size()) == static_cast<ssize_t>(buffer.size());
+
+	if (success) success = ::fdatasync(compact_fd) == 0; //大部分数据在加锁之前同步，加锁后只同步补写的部分
+
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	_synced_condition.wait(lock, [this]() { return !_syncing; }); //同步中不能替换文件
+
+	//整理期间的新写入：原样补到新文件
+	if (success && _end > snapshot_end)
+	{
+		Location location;
+		location.offset = snapshot_end;
+		location.size = _end - snapshot_end;
+
+		std::string tail;
+		read_value(location, tail);
+
+		if (success) success = ::write(compact_fd, tail.data(), tail.size()) == static_cast<ssize_t>(tail.size());
+		if (success) Replay(tail.data(), tail.size(), compact_end, compact_values, compact_players, compact_live_bytes);
+
+		compact_end += tail.size();
+	}
+
+	if (success) success = ::fdatasync(compact_fd) == 0 && ::rename(compact_path.c_str(), _path.c_str()) == 0;
+
+	if (!success)
+	{
+		CP("%s:line:%d compact storage log failed, error:%s", __func__, __LINE__, std::strerror(errno));
+
+		if (compact_fd >= 0) ::close(compact_fd);
+		::unlink(compact_path.c_str());
+
+		_compact_min_size = _end * 2; //文件再增长一倍后重试，不要连续失败
+		_compacting = false;
+		return;
+	}
+
+	std::cout << __func__ << " storage log compacted, bytes:" << _end << " -> " << compact_end << std::endl;
+
+	::close(_fd);
+	_fd = compact_fd;
+	_end = compact_end;
+	_live_bytes = compact_live_bytes;
+	_values.swap(compact_values);
+	_players.swap(compact_players);
+
+	//新文件和目录都已经同步：之前的写入已经落盘；目录同步失败则由同步线程重试后再通知
+	if (AppendLog::SyncDirectory(_path))
+	{
+		_synced = _written;
+		for (auto& completion : _completions) completion.io_service->post(std::move(completion.task));
+		_completions.clear();
+	}
+	else
+	{
+		CP("%s:line:%d sync storage log directory failed, error:%s", __func__, __LINE__, std::strerror(errno));
+
+		_directory_dirty = true; //旧文件中已经同步的写入不受影响
+	}
+
+	_synced_condition.notify_all();
+
+	_compacting = false;
+}
+
+void LogStorage::GetUser(boost::asio::io_service& io_service, const std::string& username, StringCallback callback)
+{
+	std::string value;
+	bool success = GetValue("user:" + username, value);
+
+	io_service.post([callback, success, value]() {
+				if (callback) callback(success, value);
+			});
+}
+
+void LogStorage::SetUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, StatusCallback callback)
+{
+	uint64_t written = SetValue("user:" + username, value);
+
+	Complete(io_service, written, [callback, written]() {
+				if (callback) callback(written != 0);
+			});
+}
+
+void LogStorage::LoginUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, int64_t player_id, LoginCallback callback)
+{
+	std::string key = "user:" + username, user;
+	bool success = true;
+	uint64_t written = 0;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto it = _values.find(key);
+		if (it != _values.end()) 
+		{
+			success = ReadLocked(it->second, user);
+			player_id = 0; //账号已存在
+		}
+		else
+		{
+			written = Append(RECORD_TYPE_VALUE, key, value);
+			success = written != 0;
+			user = value;
+		}
+	}
+
+	if (!success) player_id = 0;
+
+	Complete(io_service, written, [callback, success, player_id, user]() {
+				if (callback) callback(success, player_id, user);
+			});
+}
+
+void LogStorage::LoadPlayer(boost::asio::io_service& io_service, int64_t player_id, PlayerCallback callback)
+{
+	PlayerRecord record = GetPlayer(player_id);
+
+	io_service.post([callback, record]() {
+				if (callback) callback(record);
+			});
+}
+
+void LogStorage::SavePlayer(boost::asio::io_service& io_service, int64_t player_id, const PlayerSections& sections, StatusCallback callback)
+{
+	uint64_t written = SetPlayer(player_id, sections);
+
+	Complete(io_service, written, [callback, written]() {
+				if (callback) callback(written != 0);
+			});
+}
+
+void LogStorage::LoadPlayers(const std::vector<int64_t>& player_list, std::vector<PlayerRecord>& records)
+{
+	records.clear();
+	for (auto player_id : player_list) records.push_back(GetPlayer(player_id));
+}
+
+bool LogStorage::SavePlayers(const PlayerBatch& players, std::vector<int64_t>& failed)
+{
+	failed.clear();
+
+	uint64_t last_written = 0;
+	std::vector<int64_t> player_list;
+
+	for (const auto& player : players)
+	{
+		if (player.second.empty()) continue;
+
+		uint64_t written = SetPlayer(player.first, player.second);
+		if (written == 0)
+		{
+			failed.push_back(player.first);
+			continue;
+		}
+
+		last_written = written;
+		player_list.push_back(player.first);
+	}
+
+	//所有写入一起等待同步
+	if (last_written && !WaitSynced(last_written)) failed.insert(failed.end(), player_list.begin(), player_list.end());
+
+	return failed.empty();
+}
+
+int64_t LogStorage::IncrBy(const std::string& key, int64_t count)
+{
+	int64_t value = 0;
+	uint64_t written = 0;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		std::string current;
+		auto it = _values.find("counter:" + key);
+		if (it != _values.end() && !ReadLocked(it->second, current)) return 0;
+
+		value = std::strtoll(current.c_str(), nullptr, 10) + count;
+		written = Append(RECORD_TYPE_VALUE, "counter:" + key, std::to_string(value));
+	}
+
+	if (!WaitSynced(written)) return 0; //没有同步到磁盘，重启后可能重复分配
+
+	return value;
+}
+
+bool LogStorage::GetOnlinePlayers(std::vector<int64_t>& player_list)
+{
+	player_list.clear();
+
+	std::string value;
+	if (!GetValue("online_players", value)) return false;
+
+	const char* begin = value.c_str();
+	while (*begin)
+	{
+		char* end = nullptr;
+		int64_t player_id = std::strtoll(begin, &end, 10);
+		if (end == begin) break;
+
+		if (player_id > 0) player_list.push_back(player_id);
+
+		begin = *end == ',' ? end + 1 : end;
+	}
+
+	return true;
+}
+
+bool LogStorage::SetOnlinePlayers(const std::vector<int64_t>& player_list)
+{
+	std::string value;
+	for (auto player_id : player_list)
+	{
+		if (value.size()) value += ",";
+		value += std::to_string(player_id);
+	}
+
+	return WaitSynced(SetValue("online_players", value));
+}
+
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include "Storage.h"
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 本地存储：单机部署不需要数据库，数据追加写入日志文件，内存中保存索引(数据在文件中的位置).
+ *
+ * 写入：每次操作顺序追加一条记录(写入系统缓存)，提交线程定期统一同步到磁盘(fdatasync)，同步后才回调.
+ *
+ * 读取：根据索引直接读取文件(pread)，一次读取.
+ *
+ * 启动：顺序读取日志重建索引，末尾不完整的记录(写入时宕机)截断.
+ *
+ * 整理：日志大小超过有效数据的若干倍时，在后台把有效数据写入新文件后替换；整理期间的写入最后补到新文件.
+ *
+ * 配置：
+ *
+ * StorageLogPath：日志文件，默认storage.log.
+ *
+ * StorageLogSyncInterval：同步到磁盘的周期(MS)，默认10.
+ *
+ * StorageLogCompactRatio：日志大小与有效数据的比例，超出则整理，默认3；StorageLogCompactMinSize：小于该大小(MB)不整理，默认64.
+ *
+ * */
+
+class LogStorage : public Storage
+{
+private:
+	enum RECORD_TYPE
+	{
+		RECORD_TYPE_VALUE = 1, //键值：账号、计数器、在线列表
+		RECORD_TYPE_PLAYER = 2, //玩家：一条记录包含多个段
+	};
+
+	//数据在文件中的位置
+	struct Location
+	{
+		uint64_t offset = 0;
+		uint32_t size = 0;
+	};
+
+	typedef std::unordered_map<std::string, Location> ValueIndex;
+	typedef std::unordered_map<int64_t, std::unordered_map<std::string, Location>> PlayerIndex;
+
+	//等待同步到磁盘的回调
+	struct Completion
+	{
+		uint64_t written = 0; //写入后的累计字节数
+		boost::asio::io_service* io_service = nullptr;
+		std::function<void()> task;
+	};
+
+	std::string _path;
+	int32_t _sync_interval = 10;
+	int32_t _compact_ratio = 3;
+	uint64_t _compact_min_size = 64 * 1024 * 1024;
+
+	std::mutex _mutex;
+	std::condition_variable _synced_condition;
+	std::condition_variable _commit_condition;
+	int _fd = -1;
+	uint64_t _end = 0; //文件大小
+	uint64_t _written = 0; //累计写入字节数，整理后不变，用于判断是否已同步
+	uint64_t _synced = 0; //已同步到磁盘的累计字节数
+	uint64_t _live_bytes = 0; //有效数据大小
+	bool _stopped = false;
+	bool _syncing = false; //正在同步，整理时不能替换文件
+	bool _compacting = false;
+	bool _directory_dirty = false; //整理后目录同步失败，同步时重试
+
+	ValueIndex _values;
+	PlayerIndex _players;
+	std::vector<Completion> _completions;
+
+	std::shared_ptr<std::thread> _commit_thread;
+	std::shared_ptr<std::thread> _compact_thread;
+private:
+	static void EncodeRecord(RECORD_TYPE type, const std::string& key, const std::string& value, std::string& record);
+
+	//解析记录，更新索引，返回有效数据的长度(末尾不完整的记录之前)
+	uint64_t Replay(const char* data, uint64_t size, uint64_t base_offset, ValueIndex& values, PlayerIndex& players, uint64_t& live_bytes);
+
+	bool Recover();
+
+	//追加记录，返回写入后的累计字节数，失败为0；需要加锁
+	uint64_t Append(RECORD_TYPE type, const std::string& key, const std::string& value);
+	bool ReadLocked(const Location& location, std::string& value);
+	bool GetValue(const std::string& key, std::string& value);
+	uint64_t SetValue(const std::string& key, const std::string& value);
+	uint64_t SetPlayer(int64_t player_id, const PlayerSections& sections);
+	PlayerRecord GetPlayer(int64_t player_id);
+
+	bool WaitSynced(uint64_t written); //同步接口：等待同步到磁盘，写入失败(0)返回false
+	void Complete(boost::asio::io_service& io_service, uint64_t written, std::function<void()> task); //异步接口：同步后回调
+
+	void Commit(); //提交线程
+	bool NeedCompact(); //需要加锁
+	void Compact(); //整理线程
+public:
+	LogStorage();
+	~LogStorage();
+
+	bool Load();
+
+	void GetUser(boost::asio::io_service& io_service, const std::string& username, StringCallback callback) override;
+	void SetUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, StatusCallback callback = nullptr) override;
+	void LoginUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, int64_t player_id, LoginCallback callback) override;
+
+	void LoadPlayer(boost::asio::io_service& io_service, int64_t player_id, PlayerCallback callback) override;
+	void SavePlayer(boost::asio::io_service& io_service, int64_t player_id, const PlayerSections& sections, StatusCallback callback = nullptr) override;
+
+	void LoadPlayers(const std::vector<int64_t>& player_list, std::vector<PlayerRecord>& records) override;
+	bool SavePlayers(const PlayerBatch& players, std::vector<int64_t>& failed) override;
+
+	int64_t IncrBy(const std::string& key, int64_t count) override;
+
+	bool GetOnlinePlayers(std::vector<int64_t>& player_list) override;
+	bool SetOnlinePlayers(const std::vector<int64_t>& player_list) override;
+};
+
+}
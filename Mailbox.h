@@ -0,0 +1,47 @@
+#pragma once
+
+#include <utility>
+#include <boost/asio.hpp>
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 邮箱：每个实体(玩家、房间)一个，投递到邮箱的任务在指定的线程池中串行执行.
+ *
+ * 实体的状态只在自己的邮箱中修改，其他实体通过投递任务访问，不需要加锁.
+ *
+ * 玩家：邮箱在网络连接所在的网络线程，接收协议也在邮箱中处理.
+ *
+ * 房间：邮箱在世界线程池，不同房间的游戏可以在多个线程中并行.
+ *
+ * */
+
+class Mailbox
+{
+private:
+	boost::asio::io_service::strand _strand;
+public:
+	explicit Mailbox(boost::asio::io_service& io_service) : _strand(io_service) { }
+	Mailbox(Mailbox const& right) = delete;
+	Mailbox& operator=(Mailbox const& right) = delete;
+
+	//投递任务：稍后在邮箱中执行
+	template<class F> void Post(F&& task) { _strand.post(std::forward<F>(task)); }
+	//当前已经在邮箱中则直接执行，否则投递
+	template<class F> void Dispatch(F&& task) { _strand.dispatch(std::forward<F>(task)); }
+	//异步回调在邮箱中执行
+	template<class F> auto Wrap(F&& handler) -> decltype(std::declval<boost::asio::io_service::strand&>().wrap(std::forward<F>(handler)))
+	{
+		return _strand.wrap(std::forward<F>(handler));
+	}
+
+	//是否在邮箱中执行
+	bool IsCurrent() const { return _strand.running_in_this_thread(); }
+
+	boost::asio::io_service& GetExecutor() { return _strand.get_io_service(); }
+};
+
+}
@@ -14,8 +14,16 @@
 #include "Timer.h"
 #include "World.h"
 #include "WorldSession.h"
+#include "Player.h"
 #include "MXLog.h"
 #include "Config.h"
+#include "ProtocolTrace.h"
+#include "FloodControl.h"
+#include "Persist.h"
+#include "RecordCache.h"
+#include "Storage.h"
+#include "CurrencyLedger.h"
+#include "IdAllocator.h"
 
 const int const_world_sleep = 50;
 
@@ -34,6 +42,18 @@ void SignalHandler(const boost::system::error_code& error, int)
 	//if (!error) World::StopNow(SHUTDOWN_EXIT_CODE);
 }
 
+//重新加载配置(kill -HUP)：运行时调整协议跟踪
+void ReloadHandler(boost::asio::signal_set& signals, const boost::system::error_code& error)
+{
+	if (error) return;
+
+	std::string error_message;
+	if (ConfigInstance.Reload(error_message)) ProtocolTraceInstance.Load();
+	else std::cerr << __func__ << ":Reload config error:" << error_message << std::endl;
+
+	signals.async_wait(std::bind(&ReloadHandler, std::ref(signals), std::placeholders::_1));
+}
+
 void WorldUpdateLoop()
 {
 	int32_t curr_time = 0, prev_sleep_time = 0;
@@ -102,16 +122,36 @@ int main(int argc, const char* argv[])
 	
 		//日志系统配置
 		MXLogInstance.Load();
+		//协议跟踪配置
+		ProtocolTraceInstance.Load();
+		//流量控制配置
+		FloodControlInstance.Load();
+		//延迟存盘配置
+		PersistInstance.Load();
+		//存储配置
+		if (!Storage::Load()) return 9;
+		//数据缓存配置
+		RecordCacheInstance.Load();
+		//货币流水：恢复余额
+		if (!LedgerInstance.Load()) return 10;
 	
 /////////////////////////////////////////////////////游戏逻辑初始化
 
 		//世界初始化，涵盖所有....
+		WorldInstance.SetExecutor(&_io_service); //房间等实体的邮箱在此线程池中执行
 		if (!WorldInstance.Load()) return 1;
 
+		//存盘线程
+		PersistInstance.Start();
+		//流水提交线程
+		LedgerInstance.Start();
+		//缓存预热：上次停服时在线的玩家
+		RecordCacheInstance.Warm();
 		//网络初始化
 		_io_service_work = std::make_shared<boost::asio::io_service::work>(_io_service);
 
-		int _thread_nums = 5;
+		int _thread_nums = ConfigInstance.GetInt("WorldThreadCount", 5); //世界线程池：房间的游戏逻辑并行执行
+		if (_thread_nums <= 0) _thread_nums = 1;
 		std::vector<std::shared_ptr<std::thread>> _threads;	
 		for (int i = 0; i < _thread_nums; ++i)
 		{
@@ -122,6 +162,8 @@ int main(int argc, const char* argv[])
 		//boost::asio::signal_set signals(_io_service, SIGINT, SIGTERM);
 		//signals.async_wait(SignalHandler);
 		//
+		boost::asio::signal_set reload_signals(_io_service, SIGHUP);
+		reload_signals.async_wait(std::bind(&ReloadHandler, std::ref(reload_signals), std::placeholders::_1));
 
 		std::string server_ip = ConfigInstance.GetString("ServerIP", "0.0.0.0");
 		if (server_ip.empty()) return 4;
@@ -131,15 +173,32 @@ int main(int argc, const char* argv[])
 		
 		int32_t thread_count = ConfigInstance.GetInt("ThreadCount", 5);
 		if (thread_count <= 0) return 6;
+		
+		bool reuse_port = ConfigInstance.GetBool("ReusePort", false); //每个网络线程独立监听
+		
+		int32_t accept_count = ConfigInstance.GetInt("AcceptCount", 1); //每个监听未完成的ACCEPT数量
+		if (accept_count <= 0) return 7;
+
+		//角色和房间ID：按网络、世界和主线程数先租用第一批，之后由租用线程补充
+		if (!IdAllocator::Load(thread_count + _thread_nums + 1)) return 11;
 
-		WorldSessionInstance.StartNetwork(_io_service, server_ip, server_port, thread_count);
+		if (!WorldSessionInstance.StartNetwork(_io_service, server_ip, server_port, thread_count, reuse_port, accept_count)) return 8;
 
 		//世界循环
 		WorldUpdateLoop();
 	
 		std::cout << "Service stop..." << std::endl;
 
+		//先停止网络线程并等待退出，之后不会再有协议修改玩家数据
+		WorldSessionInstance.StopNetwork();
+
 		ShutdownThreadPool(_threads);
+		IdAllocator::Stop();
+
+		//停服存盘：网络线程和世界线程都已退出，先写完已有快照，再把所有玩家一次批量写入
+		PersistInstance.Stop();
+		PlayerInstance.SaveAll();
+		LedgerInstance.Stop();
 	}
 	catch (std::exception& e)
 	{
@@ -49,9 +49,9 @@ public:
 					return Asset::ERROR_DIAMOND_NOT_ENOUGH; //钻石不足
 				}
 
-				player->ConsumeDiamond(diamond);
+				player->ConsumeDiamond(diamond, Asset::CURRENCY_REASON_MALL);
 
-				player->IncreaseHuanledou(mall->count());
+				player->IncreaseHuanledou(mall->count(), Asset::CURRENCY_REASON_MALL);
 			}
 			break;
 			
@@ -71,8 +71,8 @@ public:
 					return Asset::ERROR_BEANS_NOT_ENOUGH; //欢乐豆不足
 				}
 				
-				player->ConsumeDiamond(diamond); //消耗钻石
-				player->ConsumeHuanledou(huanledou); //消耗欢乐豆
+				player->ConsumeDiamond(diamond, Asset::CURRENCY_REASON_MALL); //消耗钻石
+				player->ConsumeHuanledou(huanledou, Asset::CURRENCY_REASON_MALL); //消耗欢乐豆
 
 				player->GainItem(mall->item_id(), mall->count()); //获取物品
 			}
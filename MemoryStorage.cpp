@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <thread>
+#include <chrono>
+
+#include "MemoryStorage.h"
+#include "Config.h"
+
+namespace Adoter
+{
+
+MemoryStorage::MemoryStorage()
+{
+	_latency = std::max(0, ConfigInstance.GetInt("StorageLatency", 0));
+	_jitter = std::max(0, ConfigInstance.GetInt("StorageLatencyJitter", 0));
+	_seed = ConfigInstance.GetInt("StorageLatencySeed", 0);
+}
+
+int32_t MemoryStorage::GetLatency()
+{
+	if (_jitter == 0) return _latency;
+
+	static thread_local std::mt19937 generator(_seed);
+	std::uniform_int_distribution<int32_t> distribution(0, _jitter);
+
+	return _latency + distribution(generator);
+}
+
+void MemoryStorage::Delay()
+{
+	int32_t latency = GetLatency();
+	if (latency > 0) std::this_thread::sleep_for(std::chrono::milliseconds(latency));
+}
+
+void MemoryStorage::Complete(boost::asio::io_service& io_service, std::function<void()> task)
+{
+	int32_t latency = GetLatency();
+
+	if (latency <= 0)
+	{
+		io_service.post(task); //和数据库一样，不在调用中直接回调
+		return;
+	}
+
+	auto timer = std::make_shared<boost::asio::deadline_timer>(io_service, boost::posix_time::milliseconds(latency));
+	timer->async_wait([timer, task](const boost::system::error_code& error) {
+				task();
+			});
+}
+
+PlayerRecord MemoryStorage::Get(int64_t player_id)
+{
+	PlayerRecord record;
+	record.success = true;
+
+	Stripe& stripe = GetStripe(player_id);
+	std::lock_guard<std::mutex> lock(stripe.mutex);
+
+	auto it = stripe.players.find(player_id);
+	if (it == stripe.players.end()) return record;
+
+	record.sections = it->second;
+	for (const auto& section : record.sections) record.stuff += section.second;
+
+	return record;
+}
+
+void MemoryStorage::Set(int64_t player_id, const PlayerSections& sections)
+{
+	Stripe& stripe = GetStripe(player_id);
+	std::lock_guard<std::mutex> lock(stripe.mutex);
+
+	auto& stored = stripe.players[player_id];
+	for (const auto& section : sections) stored[section.first] = section.second; //只覆盖给定的段
+}
+
+void MemoryStorage::GetUser(boost::asio::io_service& io_service, const std::string& username, StringCallback callback)
+{
+	std::string value;
+	{
+		Stripe& stripe = GetStripe(username);
+		std::lock_guard<std::mutex> lock(stripe.mutex);
+
+		auto it = stripe.users.find(username);
+		if (it != stripe.users.end()) value = it->second;
+	}
+
+	Complete(io_service, [callback, value]() {
+				if (callback) callback(true, value);
+			});
+}
+
+void MemoryStorage::SetUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, StatusCallback callback)
+{
+	{
+		Stripe& stripe = GetStripe(username);
+		std::lock_guard<std::mutex> lock(stripe.mutex);
+
+		stripe.users[username] = value;
+	}
+
+	Complete(io_service, [callback]() {
+				if (callback) callback(true);
+			});
+}
+
+void MemoryStorage::LoginUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, int64_t player_id, LoginCallback callback)
+{
+	std::string user;
+	{
+		Stripe& stripe = GetStripe(username);
+		std::lock_guard<std::mutex> lock(stripe.mutex);
+
+		auto it = stripe.users.emplace(username, value);
+		if (it.second) user = value;
+		else
+		{
+			user = it.first->second;
+			player_id = 0; //账号已存在
+		}
+	}
+
+	Complete(io_service, [callback, player_id, user]() {
+				if (callback) callback(true, player_id, user);
+			});
+}
+
+void MemoryStorage::LoadPlayer(boost::asio::io_service& io_service, int64_t player_id, PlayerCallback callback)
+{
+	PlayerRecord record = Get(player_id);
+
+	Complete(io_service, [callback, record]() {
+				if (callback) callback(record);
+			});
+}
+
+void MemoryStorage::SavePlayer(boost::asio::io_service& io_service, int64_t player_id, const PlayerSections& sections, StatusCallback callback)
+{
+	Set(player_id, sections);
+
+	Complete(io_service, [callback]() {
+				if (callback) callback(true);
+			});
+}
+
+void MemoryStorage::LoadPlayers(const std::vector<int64_t>& player_list, std::vector<PlayerRecord>& records)
+{
+	Delay(); //批量操作只有一次延迟
+
+	records.clear();
+	for (auto player_id : player_list) records.push_back(Get(player_id));
+}
+
+bool MemoryStorage::SavePlayers(const PlayerBatch& players, std::vector<int64_t>& failed)
+{
+	Delay();
+
+	failed.clear();
+	for (const auto& player : players) Set(player.first, player.second);
+
+	return true;
+}
+
+int64_t MemoryStorage::IncrBy(const std::string& key, int64_t count)
+{
+	Delay();
+
+	Stripe& stripe = GetStripe(key);
+	std::lock_guard<std::mutex> lock(stripe.mutex);
+
+	return stripe.counters[key] += count;
+}
+
+bool MemoryStorage::GetOnlinePlayers(std::vector<int64_t>& player_list)
+{
+	std::lock_guard<std::mutex> lock(_online_mutex);
+	player_list = _online_players;
+	return true;
+}
+
+bool MemoryStorage::SetOnlinePlayers(const std::vector<int64_t>& player_list)
+{
+	std::lock_guard<std::mutex> lock(_online_mutex);
+	_online_players = player_list;
+	return true;
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <mutex>
+#include <random>
+
+#include "Storage.h"
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 内存存储：数据保存在进程内，停服丢失；用于压测和机器人测试，不需要数据库.
+ *
+ * 数据按键分到多个分段，每段一把锁，不同玩家的读写互不等待.
+ *
+ * 配置：
+ *
+ * StorageLatency：模拟数据库延迟(MS)，默认0；StorageLatencyJitter：随机增加的延迟上限(MS)，默认0.
+ *
+ * StorageLatencySeed：随机种子，相同种子每个线程的延迟序列相同，结果可重现.
+ *
+ * */
+
+class MemoryStorage : public Storage
+{
+private:
+	static const size_t STRIPE_COUNT = 16; //分段数量
+
+	struct Stripe
+	{
+		std::mutex mutex;
+		std::unordered_map<std::string, std::string> users;
+		std::unordered_map<int64_t, PlayerSections> players;
+		std::unordered_map<std::string, int64_t> counters;
+	};
+
+	Stripe _stripes[STRIPE_COUNT];
+
+	std::mutex _online_mutex;
+	std::vector<int64_t> _online_players;
+
+	int32_t _latency = 0;
+	int32_t _jitter = 0;
+	uint32_t _seed = 0;
+private:
+	Stripe& GetStripe(const std::string& key) { return _stripes[std::hash<std::string>()(key) % STRIPE_COUNT]; }
+	Stripe& GetStripe(int64_t player_id) { return _stripes[static_cast<uint64_t>(player_id) % STRIPE_COUNT]; }
+
+	int32_t GetLatency(); //本次操作的延迟(MS)
+	void Delay(); //同步接口：等待延迟
+	void Complete(boost::asio::io_service& io_service, std::function<void()> task); //异步接口：延迟后在io_service中回调
+
+	PlayerRecord Get(int64_t player_id);
+	void Set(int64_t player_id, const PlayerSections& sections);
+public:
+	MemoryStorage();
+
+	void GetUser(boost::asio::io_service& io_service, const std::string& username, StringCallback callback) override;
+	void SetUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, StatusCallback callback = nullptr) override;
+	void LoginUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, int64_t player_id, LoginCallback callback) override;
+
+	void LoadPlayer(boost::asio::io_service& io_service, int64_t player_id, PlayerCallback callback) override;
+	void SavePlayer(boost::asio::io_service& io_service, int64_t player_id, const PlayerSections& sections, StatusCallback callback = nullptr) override;
+
+	void LoadPlayers(const std::vector<int64_t>& player_list, std::vector<PlayerRecord>& records) override;
+	bool SavePlayers(const PlayerBatch& players, std::vector<int64_t>& failed) override;
+
+	int64_t IncrBy(const std::string& key, int64_t count) override;
+
+	bool GetOnlinePlayers(std::vector<int64_t>& player_list) override;
+	bool SetOnlinePlayers(const std::vector<int64_t>& player_list) override;
+};
+
+}
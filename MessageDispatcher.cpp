@@ -49,7 +49,9 @@ bool MessageDispatcher::Discharge(int64_t receiver, const Asset::MsgItem& messag
 {
 	auto player = PlayerInstance.GetPlayer(receiver); //接收者可能不在线
 	if (!player) return false;
-	player->HandleMessage(message);		//交给各个接受者处理
+	player->Post([player, message]() {
+				player->HandleMessage(message);		//交给各个接受者处理：在玩家邮箱中执行
+			});
 	return true;
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
 #include <functional>
 #include <boost/asio.hpp>
 
@@ -10,16 +11,25 @@ class AsyncAcceptor
 {
 public:
     	typedef void(*AcceptCallback)(tcp::socket&& socket, int32_t thread_index);
+	//多个监听绑定同一端口，由内核分配连接
+	typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
 
-    	AsyncAcceptor(boost::asio::io_service& io_service, const std::string& bind_ip, int32_t port) :
-		_acceptor(io_service, tcp::endpoint(boost::asio::ip::address::from_string(bind_ip), port)),
-        	_socket(io_service), _closed(false), _socket_factory(std::bind(&AsyncAcceptor::DefeaultSocketFactory, this))
+    	AsyncAcceptor(boost::asio::io_service& io_service, const std::string& bind_ip, int32_t port, bool is_reuse_port = false) :
+		_acceptor(io_service), _socket(io_service), _closed(false), _socket_factory(std::bind(&AsyncAcceptor::DefeaultSocketFactory, this))
     	{
+		tcp::endpoint endpoint(boost::asio::ip::address::from_string(bind_ip), port);
+
+		_acceptor.open(endpoint.protocol());
+		_acceptor.set_option(tcp::acceptor::reuse_address(true));
+		if (is_reuse_port) _acceptor.set_option(reuse_port(true));
+		_acceptor.bind(endpoint);
+		_acceptor.listen();
     	}
 
     	template<class T> void AsyncAccept();
 
-    	template<AcceptCallback accept_callback> void AsyncAcceptWithCallback();
+	//同时保持accept_count个未完成的ACCEPT，连接高峰时不必排队等待单个回调
+    	template<AcceptCallback accept_callback> void AsyncAcceptWithCallback(int32_t accept_count = 1);
 
 	void Close()
 	{
@@ -29,18 +39,20 @@ public:
 		_acceptor.close(err);
 	}
 
-    void SetSocketFactory(std::function<std::pair<tcp::socket*, int32_t>()> func) { _socket_factory = func; }
+    void SetSocketFactory(std::function<std::pair<std::shared_ptr<tcp::socket>, int32_t>()> func) { _socket_factory = func; }
 
 private:
-	std::pair<tcp::socket*, int32_t> DefeaultSocketFactory() { return std::make_pair(&_socket, 0); }
+    	template<AcceptCallback accept_callback> void AsyncAcceptOne();
+
+	std::pair<std::shared_ptr<tcp::socket>, int32_t> DefeaultSocketFactory() { return std::make_pair(std::make_shared<tcp::socket>(_acceptor.get_io_service()), 0); }
 
 	tcp::acceptor _acceptor;
 	tcp::socket _socket;
 	std::atomic<bool> _closed;
-	std::function<std::pair<tcp::socket*, int32_t>()> _socket_factory;
+	std::function<std::pair<std::shared_ptr<tcp::socket>, int32_t>()> _socket_factory; //每次ACCEPT一个新的SOCKET
 };
 
-template<class T> 
+template<class T>
 void AsyncAcceptor::AsyncAccept()
 {
    	_acceptor.async_accept(_socket, [this](boost::system::error_code error)
@@ -60,10 +72,18 @@ void AsyncAcceptor::AsyncAccept()
     	});
 }
 
-template<AsyncAcceptor::AcceptCallback accept_callback> 
-void AsyncAcceptor::AsyncAcceptWithCallback()
+template<AsyncAcceptor::AcceptCallback accept_callback>
+void AsyncAcceptor::AsyncAcceptWithCallback(int32_t accept_count)
 {
-	tcp::socket* socket;
+	if (accept_count <= 0) accept_count = 1;
+
+	for (int32_t i = 0; i < accept_count; ++i) AsyncAcceptOne<accept_callback>();
+}
+
+template<AsyncAcceptor::AcceptCallback accept_callback>
+void AsyncAcceptor::AsyncAcceptOne()
+{
+	std::shared_ptr<tcp::socket> socket;
 	int32_t thread_index;
 	std::tie(socket, thread_index) = _socket_factory();
 	_acceptor.async_accept(*socket, [this, socket, thread_index](boost::system::error_code error)
@@ -81,7 +101,6 @@ void AsyncAcceptor::AsyncAcceptWithCallback()
 			}
 		}
 
-		if (!_closed) this->AsyncAcceptWithCallback<accept_callback>();
+		if (!_closed) this->AsyncAcceptOne<accept_callback>(); //完成一个补充一个
 	});
 }
-
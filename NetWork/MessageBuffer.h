@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 接收缓存：每个连接一个，可增长.
+ *
+ * 读写位置分离，数据直接在缓存中解析，不做拷贝；未收完整的数据保留到下次接收.
+ *
+ * */
+
+class MessageBuffer
+{
+	typedef std::vector<unsigned char>::size_type size_type;
+public:
+	MessageBuffer() : _wpos(0), _rpos(0), _storage() { _storage.resize(4096); }
+	explicit MessageBuffer(std::size_t initial_size) : _wpos(0), _rpos(0), _storage() { _storage.resize(initial_size); }
+
+	MessageBuffer(MessageBuffer const& right) = delete;
+	MessageBuffer& operator=(MessageBuffer const& right) = delete;
+
+	void Reset() { _wpos = 0; _rpos = 0; }
+
+	void Resize(size_type bytes) { _storage.resize(bytes); }
+
+	unsigned char* GetBasePointer() { return _storage.data(); }
+	unsigned char* GetReadPointer() { return GetBasePointer() + _rpos; }
+	unsigned char* GetWritePointer() { return GetBasePointer() + _wpos; }
+
+	void ReadCompleted(size_type bytes) { _rpos += bytes; }
+	void WriteCompleted(size_type bytes) { _wpos += bytes; }
+
+	size_type GetActiveSize() const { return _wpos - _rpos; } //未处理数据
+	size_type GetRemainingSpace() const { return _storage.size() - _wpos; } //剩余可写空间
+	size_type GetBufferSize() const { return _storage.size(); }
+
+	//已处理数据丢弃，未处理数据移到缓存头部
+	void Normalize()
+	{
+		if (_rpos)
+		{
+			if (_rpos != _wpos) std::memmove(GetBasePointer(), GetReadPointer(), GetActiveSize());
+			_wpos -= _rpos;
+			_rpos = 0;
+		}
+	}
+
+	//保证至少有bytes字节可写，不够则增长(每次至少增长一半)
+	void EnsureFreeSpace(size_type bytes = 1)
+	{
+		if (GetRemainingSpace() >= bytes) return;
+
+		Normalize();
+
+		if (GetRemainingSpace() >= bytes) return;
+
+		size_type grow = _storage.size() / 2;
+		if (grow < bytes - GetRemainingSpace()) grow = bytes - GetRemainingSpace();
+
+		_storage.resize(_storage.size() + grow);
+	}
+
+private:
+	size_type _wpos; //写位置
+	size_type _rpos; //读位置
+	std::vector<unsigned char> _storage;
+};
+
+}
@@ -3,8 +3,10 @@
 #include <memory>
 #include <atomic>
 #include <thread>
+#include <unordered_map>
 #include <boost/asio.hpp>
-#include <boost/asio/deadline_timer.hpp>
+
+#include "AsyncAcceptor.h"
 
 namespace Adoter 
 {
@@ -19,7 +21,7 @@ template<class SOCKET_TYPE>
 class NetworkThread
 {
 public:    
-	NetworkThread() : _connections(0), _stopped(false), _thread(nullptr), _accept_socket(_io_service), _update_timer(_io_service)    {    }
+	NetworkThread() : _connections(0), _stopped(false), _thread(nullptr)    {    }
 	virtual ~NetworkThread()    
 	{        
 		Stop();        
@@ -33,6 +35,7 @@ public:
 
 	virtual void Stop() { 
 		_stopped = true;
+		if (_acceptor) _acceptor->Close();
 		_io_service.stop();
 	}
 
@@ -52,83 +55,71 @@ public:
 
 	virtual int32_t GetConnectionCount() const { return _connections; }
 
+	//新连接：必须在SOCKET开始收发之前调用，保证关闭通知晚于加入
 	virtual void AddSocket(std::shared_ptr<SOCKET_TYPE> socket)
 	{
-		std::lock_guard<std::mutex> lock(_fresh_mutex);
-
 		++_connections;
-		_fresh_list.push_back(socket);
-		SocketAdded(socket); //目前无用途
+
+		socket->SetCloseHandler(std::bind(&NetworkThread<SOCKET_TYPE>::OnSocketClose, this, socket.get()));
+
+		_io_service.post([this, socket]() {
+					this->_socket_list.emplace(socket.get(), socket);
+					this->SocketAdded(socket); //目前无用途
+				});
 	}
 
-	tcp::socket* GetSocketForAccept() { return &_accept_socket; }
+	//新连接的SOCKET：绑定本线程，每个未完成的ACCEPT各用一个
+	std::shared_ptr<tcp::socket> GetSocketForAccept() { return std::make_shared<tcp::socket>(_io_service); }
 
-	//把添加的SOCKET都加载进来
-	virtual void AddSockets()
+	//本线程独立监听(SO_REUSEPORT)：由内核把新连接分配到各网络线程，ACCEPT也在本线程完成
+	template<AsyncAcceptor::AcceptCallback accept_callback>
+	void StartAcceptor(const std::string& bind_ip, int32_t port, int32_t thread_index, int32_t accept_count)
 	{
-		std::lock_guard<std::mutex> lock(_fresh_mutex);
-		if (_fresh_list.empty()) return;
-		for (auto socket : _fresh_list)
-		{
-			if (socket->IsOpen())
-			{
-				_socket_list.push_back(socket);
-			}
-			else
-			{
-				--_connections;
-				SocketRemoved(socket); //目前无用途
-			}
-		}
-		_fresh_list.clear();
+		_acceptor = std::make_shared<AsyncAcceptor>(_io_service, bind_ip, port, true);
+		_acceptor->SetSocketFactory([this, thread_index]() {
+					return std::make_pair(this->GetSocketForAccept(), thread_index);
+				});
+		_acceptor->AsyncAcceptWithCallback<accept_callback>(accept_count);
 	}
 
 	virtual void Run()
 	{
 		std::cout << "Starting network thread..." << std::endl;
-		_update_timer.expires_from_now(boost::posix_time::milliseconds(10));
-		_update_timer.async_wait(std::bind(&NetworkThread<SOCKET_TYPE>::Update, this));        
+
+		boost::asio::io_service::work work(_io_service); //没有连接时也不退出
 		
 		_io_service.run();
 
 		_socket_list.clear();        
-		_fresh_list.clear();
 	}
 	
-	virtual void Update() //每0.01秒检查一次，删除不活跃的连接
+	//连接关闭通知：可能在任意线程调用，回收放到本线程处理，不再定时轮询所有连接
+	virtual void OnSocketClose(SOCKET_TYPE* socket)
 	{
 		if (_stopped) return;
-		_update_timer.expires_from_now(boost::posix_time::milliseconds(10));
-		_update_timer.async_wait(std::bind(&NetworkThread<SOCKET_TYPE>::Update, this));        
-		//删除不连接的SOCKET，同时更新新连接的SOCKET
-		AddSockets();
-		_socket_list.erase(std::remove_if(_socket_list.begin(), _socket_list.end(), [this] (std::shared_ptr<SOCKET_TYPE> socket) {
-			if (!socket->Update())
-			{
-				if (socket->IsOpen()) socket->Close();
-				this->SocketRemoved(socket);
-				--this->_connections;
-				return true;
-			}
-			return false;
-		}), _socket_list.end()); 
+
+		_io_service.post([this, socket]() {
+					auto it = this->_socket_list.find(socket);
+					if (it == this->_socket_list.end()) return;
+
+					auto removed = it->second;
+					this->_socket_list.erase(it);
+					--this->_connections;
+					this->SocketRemoved(removed); //目前无用途
+				});
 	}
 protected:
 	virtual void SocketAdded(std::shared_ptr<SOCKET_TYPE>) { }    
 	virtual void SocketRemoved(std::shared_ptr<SOCKET_TYPE>) { }
 private:
-	std::vector<std::shared_ptr<SOCKET_TYPE>> _socket_list; //连接的SOCKET列表
+	std::unordered_map<SOCKET_TYPE*, std::shared_ptr<SOCKET_TYPE>> _socket_list; //连接的SOCKET列表，只在本线程访问
 	std::atomic<int32_t> _connections;    
 	std::atomic<bool> _stopped;
 	
 	std::shared_ptr<std::thread> _thread;	
-	
-	std::mutex _fresh_mutex;
-	std::vector<std::shared_ptr<SOCKET_TYPE>> _fresh_list; //新连接的SOCKET列表
 
 	boost::asio::io_service _io_service;
-	tcp::socket _accept_socket;
-	boost::asio::deadline_timer _update_timer;
+	std::shared_ptr<AsyncAcceptor> _acceptor; //独立监听模式下使用
 };
 
 }
@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <boost/asio.hpp>
 #include "Protocol.h"
+#include "MessageBuffer.h"
 #include "AsyncAcceptor.h"
 #include "NetThread.h"
 
@@ -21,22 +22,22 @@ class Socket : public std::enable_shared_from_this<T>
 {
 public:
 	S _socket; 
+	//包检查结果
+	enum FRAME_CHECK_RESULT
+	{
+		FRAME_CHECK_OK = 0, //正常处理
+		FRAME_CHECK_DROP = 1, //丢弃
+		FRAME_CHECK_DELAY = 2, //暂停处理，数据保留
+		FRAME_CHECK_CLOSE = 3, //断开连接
+	};
 public:
-	explicit Socket(boost::asio::ip::tcp::socket&& socket) : _socket(std::move(socket)), _closed(false), _closing(false) { }
+	explicit Socket(boost::asio::ip::tcp::socket&& socket) : _socket(std::move(socket)), _closed(false), _closing(false), _read_delayed(false), _is_writing_async(false) { }
 	virtual ~Socket() 
 	{
 		//std::cout << __func__ <<  _socket.remote_endpoint().address() << std::endl;
 		//_socket.close();
 	}
 	
-	virtual bool Update() {
-		if (_closed) return false;
-		//发送可以放到消息队列里面处理
-		//if (_isWritingAsync || (_writeQueue.empty() && !_closing)) return true;
-		//for (; HandleQueue();) {}
-		return true;
-	}
-
 	virtual S& GetStream() { return _socket; } //当前字节流
 	virtual boost::asio::ip::tcp::socket::endpoint_type GetRemoteEndPoint() const { return _socket.remote_endpoint(); }
 	virtual void Start() = 0; 
@@ -48,50 +49,219 @@ public:
 		_socket.shutdown(boost::asio::socket_base::shutdown_send, error);
 
 		OnClose();
+
+		if (_close_handler) _close_handler(); //通知网络线程回收
+	}
+	//连接关闭通知：SOCKET开始收发之前设置
+	void SetCloseHandler(std::function<void()> handler) { _close_handler = handler; }
+	virtual void DelayedClose() //发送队列为空时再进行关闭
+	{
+		if (_closing.exchange(true)) return;
+
+		bool is_writing = false;
+		{
+			std::lock_guard<std::mutex> lock(_write_mutex);
+			is_writing = _is_writing_async;
+		}
+
+		if (!is_writing) _socket.get_io_service().post(std::bind(&Socket<T, S>::Close, this->shared_from_this()));
 	}
-	virtual void DelayedClose() { _closing = true; } //发送队列为空时再进行关闭
 	virtual bool IsConnect() { return _socket.is_open(); }
 	virtual bool IsOpen() const { return !_closed && !_closing; }
 
 	virtual void AsyncReceive()
 	{
-		_socket.async_read_some(boost::asio::buffer(_buffer), std::bind(&Socket<T, S>::OnReceive, this, std::placeholders::_1, std::placeholders::_2));
+		_read_buffer.Normalize();
+		_read_buffer.EnsureFreeSpace();
+		_socket.async_read_some(boost::asio::buffer(_read_buffer.GetWritePointer(), _read_buffer.GetRemainingSpace()), 
+				std::bind(&Socket<T, S>::OnReceive, this, std::placeholders::_1, std::placeholders::_2));
 	}
 	virtual void OnReceive(const boost::system::error_code& error, const std::size_t bytes_transferred)
 	{
+		if (error) 
+		{
+			Close();
+			return;
+		}
+
+		_read_buffer.WriteCompleted(bytes_transferred);
+
+		if (!ReadFrames()) 
+		{
+			Close();
+			return;
+		}
+
 		AsyncReceive();
 	}
 	virtual void AsyncReceiveWithCallback(void(T::*callback)(boost::system::error_code, std::size_t))
 	{
-		_socket.async_read_some(boost::asio::buffer(_buffer), std::bind(callback, this->shared_from_this(), std::placeholders::_1, std::placeholders::_2));
+		_read_buffer.Normalize();
+		_read_buffer.EnsureFreeSpace();
+		_socket.async_read_some(boost::asio::buffer(_read_buffer.GetWritePointer(), _read_buffer.GetRemainingSpace()), 
+				std::bind(callback, this->shared_from_this(), std::placeholders::_1, std::placeholders::_2));
 	}
+	//解析接收缓存中所有完整的包，不完整的包留到下次接收：返回FALSE则需要断开连接
+	virtual bool ReadFrames()
+	{
+		_read_delayed = false;
+
+		while (_read_buffer.GetActiveSize() >= FRAME_HEADER_SIZE)
+		{
+			const unsigned char* header = _read_buffer.GetReadPointer();
+			
+			std::size_t size = (std::size_t(header[0]) << 24) | (std::size_t(header[1]) << 16) | (std::size_t(header[2]) << 8) | std::size_t(header[3]);
+			if (size == 0 || size > MAX_FRAME_SIZE) return false; //非法包长
+
+			if (_read_buffer.GetActiveSize() < FRAME_HEADER_SIZE + size) 
+			{
+				_read_buffer.EnsureFreeSpace(FRAME_HEADER_SIZE + size - _read_buffer.GetActiveSize()); //包体未收全，预留足够空间
+				break;
+			}
+
+			auto check = CheckFrame(header + FRAME_HEADER_SIZE, size); //解析前检查，不做任何解析
+			if (FRAME_CHECK_CLOSE == check) return false;
+			if (FRAME_CHECK_DELAY == check) 
+			{
+				_read_delayed = true; //数据保留在缓存中，稍后继续处理
+				break;
+			}
+			if (FRAME_CHECK_DROP == check)
+			{
+				_read_buffer.ReadCompleted(FRAME_HEADER_SIZE + size);
+				continue;
+			}
+
+			_read_buffer.ReadCompleted(FRAME_HEADER_SIZE);
+			
+			bool result = OnReceiveFrame(_read_buffer.GetReadPointer(), size); //在缓存中直接解析，不拷贝
+			
+			_read_buffer.ReadCompleted(size);
+
+			if (!result) return false;
+		}
+		return true;
+	}
+	//收到完整包，解析之前检查(比如流量控制)
+	virtual FRAME_CHECK_RESULT CheckFrame(const unsigned char* data, std::size_t size) { return FRAME_CHECK_OK; }
+	//是否暂停了处理：需要稍后再次调用ReadFrames，期间不要继续接收
+	bool IsReadDelayed() const { return _read_delayed; }
+	//处理一个完整的包：返回FALSE则需要断开连接
+	virtual bool OnReceiveFrame(const unsigned char* data, std::size_t size) { return true; }
+
 	virtual void AsyncSend(std::string& content)
 	{
 		AsyncSend(content.c_str(), content.size());
 	}
 	virtual void AsyncSend(const char* buff, size_t size)
 	{
-		boost::asio::async_write(_socket, boost::asio::buffer(buff, size), std::bind(&Socket::OnSend, this, std::placeholders::_1, std::placeholders::_2));
+		auto frame = MakeFrame(buff, size);
+		if (!frame) return;
+
+		AsyncSendFrame(frame);
+	}
+	//发送已打包的数据：可在任意线程调用，同一时刻只有一个写操作，写期间进入队列的数据下次一起发送
+	virtual void AsyncSendFrame(std::shared_ptr<const std::string> frame)
+	{
+		if (!frame || _closed) return;
 
-		/*
-		for (int i = 0; i < size; ++i)
 		{
-			std::cout << (int)buff[i] << " ";
+			std::lock_guard<std::mutex> lock(_write_mutex);
+			
+			_write_queue.push_back(frame);
+			
+			if (_is_writing_async) return; //当前写完成后会继续发送
+
+			_is_writing_async = true;
 		}
-		*/
+
+		auto self = this->shared_from_this();
+		_socket.get_io_service().post([self]() { 
+					self->HandleQueue(); 
+				}); //切换到网络线程发送
+	}
+	//打包：包头 + 包体
+	static std::shared_ptr<std::string> MakeFrame(const char* buff, size_t size)
+	{
+		if (size == 0 || size > MAX_FRAME_SIZE) return nullptr;
+
+		auto frame = std::make_shared<std::string>();
+		frame->reserve(FRAME_HEADER_SIZE + size);
+		frame->push_back(char((size >> 24) & 0xFF));
+		frame->push_back(char((size >> 16) & 0xFF));
+		frame->push_back(char((size >> 8) & 0xFF));
+		frame->push_back(char(size & 0xFF));
+		frame->append(buff, size);
+
+		return frame;
 	}
 	virtual void OnSend(const boost::system::error_code& error, std::size_t bytes_transferred)
 	{
-		std::cout << __func__ << ":bytes_transferred:" << bytes_transferred << " has error:" << error << std::endl;
+		if (error)
+		{
+			std::cout << __func__ << ":bytes_transferred:" << bytes_transferred << " has error:" << error << std::endl;
+			
+			{
+				std::lock_guard<std::mutex> lock(_write_mutex);
+				_writing_list.clear();
+				_write_queue.clear();
+				_is_writing_async = false;
+			}
+
+			Close();
+			return;
+		}
+
+		HandleQueue(); //继续发送写期间进入队列的数据
 	}
+protected:
+	//把队列中所有数据一次性发出(writev)，只在网络线程调用
+	virtual void HandleQueue()
+	{
+		std::vector<boost::asio::const_buffer> buffers;
+
+		{
+			std::lock_guard<std::mutex> lock(_write_mutex);
+
+			_writing_list.clear(); //上次已经发送完成
 
+			if (_write_queue.empty() || _closed)
+			{
+				_is_writing_async = false;
+				if (_closing && !_closed) _socket.get_io_service().post(std::bind(&Socket<T, S>::Close, this->shared_from_this())); //数据发完再关闭
+				return;
+			}
+
+			_writing_list.swap(_write_queue);
+
+			buffers.reserve(_writing_list.size());
+			for (const auto& frame : _writing_list) buffers.push_back(boost::asio::buffer(*frame));
+		}
+
+		auto self = this->shared_from_this();
+		boost::asio::async_write(_socket, buffers, [self](const boost::system::error_code& error, std::size_t bytes_transferred) {
+					self->OnSend(error, bytes_transferred);
+				});
+	}
 protected:
 	virtual void OnClose() { }
 protected:
+	//包头：4字节包体长度(网络字节序)
+	static const std::size_t FRAME_HEADER_SIZE = 4;
+	//单个包体上限
+	static const std::size_t MAX_FRAME_SIZE = 1024 * 1024;
+
 	std::atomic<bool> _closed;    
 	std::atomic<bool> _closing;
-	//接收缓存
-	std::array<unsigned char, 4096> _buffer;
+	std::function<void()> _close_handler;
+	//接收缓存：可增长，保留不完整的包
+	MessageBuffer _read_buffer;
+	bool _read_delayed;
+	//发送队列：写期间进入的数据排队，写完成后一起发出
+	std::mutex _write_mutex;
+	bool _is_writing_async;
+	std::vector<std::shared_ptr<const std::string>> _write_queue; //待发送
+	std::vector<std::shared_ptr<const std::string>> _writing_list; //发送中，写完成之前一直持有
 };
 
 template <class SOCKET_TYPE> //各种类型的SOCKET，比如Session
@@ -101,23 +271,35 @@ protected:
 	AsyncAcceptor* _acceptor; //接收连接
 	NetworkThread<SOCKET_TYPE>* _threads; //网络线程池，每个SOCKET有N个NetworkThread进行网络管理
 	int32_t _thread_count;
+	std::string _bind_ip;
+	int32_t _port;
+	bool _reuse_port; //每个网络线程独立监听
+	int32_t _accept_count; //每个监听未完成的ACCEPT数量
 protected:
-	SocketManager() : _acceptor(nullptr), _threads(nullptr), _thread_count(1) {	}
+	SocketManager() : _acceptor(nullptr), _threads(nullptr), _thread_count(1), _port(0), _reuse_port(false), _accept_count(1) {	}
 	
 	virtual NetworkThread<SOCKET_TYPE>* CreateThreads() const = 0;
 public:
 	virtual ~SocketManager() { }
 
-	virtual bool StartNetwork(boost::asio::io_service& io_service, const std::string& bind_ip, int port, int thread_count)
+	virtual bool StartNetwork(boost::asio::io_service& io_service, const std::string& bind_ip, int port, int thread_count, bool reuse_port = false, int accept_count = 1)
 	{
-		try
-		{
-			_acceptor = new AsyncAcceptor(io_service, bind_ip, port);
-		}
-		catch (const boost::system::system_error& error)
+		_bind_ip = bind_ip;
+		_port = port;
+		_reuse_port = reuse_port;
+		_accept_count = accept_count;
+
+		if (!_reuse_port) //独立监听模式下，由各网络线程各自监听
 		{
-			std::cout << __func__ << ":Start Server IP:" << bind_ip << " PORT:" << port << " Error:" << error.what() << std::endl;
-			return false;
+			try
+			{
+				_acceptor = new AsyncAcceptor(io_service, bind_ip, port);
+			}
+			catch (const boost::system::system_error& error)
+			{
+				std::cout << __func__ << ":Start Server IP:" << bind_ip << " PORT:" << port << " Error:" << error.what() << std::endl;
+				return false;
+			}
 		}
 
 		_thread_count = thread_count;
@@ -133,7 +315,7 @@ public:
 	//释放资源、清理内存
 	virtual void StopNetwork()
 	{
-		_acceptor->Close();
+		if (_acceptor) _acceptor->Close();
 		for (int32_t i = 0; i < _thread_count; ++i)
 			_threads[i].Stop();
 
@@ -159,8 +341,8 @@ public:
 		try        
 		{            
 			std::shared_ptr<SOCKET_TYPE> newSocket = std::make_shared<SOCKET_TYPE>(std::move(socket));            
+			_threads[thread_index].AddSocket(newSocket);        //网络线程：先加入再开始收发
 			newSocket->Start();            
-			_threads[thread_index].AddSocket(newSocket);        //网络线程
 		}        
 		catch (const boost::system::system_error& error)        
 		{            
@@ -179,11 +361,36 @@ public:
 		return min;    
 	}    
 	
-	std::pair<tcp::socket*, int32_t> GetSocketForAccept()    
+	std::pair<std::shared_ptr<tcp::socket>, int32_t> GetSocketForAccept()    
 	{        
 		int32_t thread_index = SelectThreadWithMinConnections();        
 		return std::make_pair(_threads[thread_index].GetSocketForAccept(), thread_index);    
 	}
+protected:
+	//开始接收连接：单个监听保持多个未完成的ACCEPT，或者每个网络线程各自监听同一端口(SO_REUSEPORT)
+	template<AsyncAcceptor::AcceptCallback accept_callback>
+	bool StartAccept()
+	{
+		if (!_reuse_port)
+		{
+			_acceptor->SetSocketFactory(std::bind(&SocketManager<SOCKET_TYPE>::GetSocketForAccept, this));    
+			_acceptor->AsyncAcceptWithCallback<accept_callback>(_accept_count);    
+			return true;
+		}
+
+		try
+		{
+			for (int32_t i = 0; i < _thread_count; ++i)
+				_threads[i].template StartAcceptor<accept_callback>(_bind_ip, _port, i, _accept_count);
+		}
+		catch (const boost::system::system_error& error)
+		{
+			std::cout << __func__ << ":Start Server IP:" << _bind_ip << " PORT:" << _port << " Error:" << error.what() << std::endl;
+			return false;
+		}
+
+		return true;
+	}
 };
 
 }
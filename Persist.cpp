@@ -0,0 +1,223 @@
+#include <chrono>
+#include <vector>
+
+#include "Persist.h"
+#include "Player.h"
+#include "CommonUtil.h"
+#include "Storage.h"
+#include "Config.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+void PersistManager::Load()
+{
+	int32_t flush_interval = ConfigInstance.GetInt("PersistFlushInterval", 5000);
+	int32_t batch_size = ConfigInstance.GetInt("PersistBatchSize", 200);
+	int32_t max_pending = ConfigInstance.GetInt("PersistMaxPending", 5000);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_flush_interval = flush_interval > 0 ? flush_interval : 5000;
+	_batch_size = batch_size > 0 ? batch_size : 200;
+	_max_pending = max_pending > 0 ? max_pending : 5000;
+}
+
+void PersistManager::Start()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_thread) return;
+
+	_stopped = false;
+	_thread = std::make_shared<std::thread>(std::bind(&PersistManager::Run, this));
+}
+
+void PersistManager::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (!_thread) return;
+
+		_stopped = true;
+	}
+
+	_condition.notify_one();
+	_thread->join();
+	_thread.reset();
+}
+
+bool PersistManager::IsRunning()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return !_stopped;
+}
+
+void PersistManager::SetDirty(std::shared_ptr<Player> player)
+{
+	if (!player) return;
+
+	bool notify = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_dirty.emplace(player->GetID(), player);
+
+		notify = _dirty.size() == _batch_size; //达到批量提前存盘
+	}
+
+	if (notify) _condition.notify_one();
+}
+
+void PersistManager::Enqueue(int64_t player_id, PlayerSections sections, bool urgent)
+{
+	if (sections.empty()) return;
+
+	bool notify = false;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto& pending = _pending[player_id];
+		for (auto& section : sections) pending[section.first] = std::move(section.second); //只保留每段最新的数据
+
+		if (urgent) _urgent = true;
+		notify = urgent || _pending.size() == _batch_size;
+	}
+
+	if (notify) _condition.notify_one();
+}
+
+void PersistManager::Run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	while (!_stopped)
+	{
+		_condition.wait_for(lock, std::chrono::milliseconds(_flush_interval), [this]() {
+					return _stopped || _urgent || _dirty.size() >= _batch_size || _pending.size() >= _batch_size;
+				});
+
+		_urgent = false;
+		bool stopped = _stopped;
+
+		lock.unlock();
+
+		bool success = Write();
+
+		if (!stopped) Snapshot(); //本次快照在下个周期写入
+
+		lock.lock();
+
+		//写入失败：等待一个周期再重试，不要持续请求数据库
+		if (!success) _condition.wait_for(lock, std::chrono::milliseconds(_flush_interval), [this]() { return _stopped; });
+	}
+
+	lock.unlock();
+
+	Write(); //停服：写入剩余快照
+}
+
+void PersistManager::Snapshot()
+{
+	std::unordered_map<int64_t, std::weak_ptr<Player>> dirty;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		if (_pending.size() >= _max_pending) //数据库写入跟不上，玩家保持脏标记
+		{
+			++_throttled_total;
+			return;
+		}
+
+		dirty.swap(_dirty);
+	}
+
+	for (const auto& it : dirty)
+	{
+		auto player = it.second.lock();
+		if (!player) continue; //已经下线，下线时已存盘
+
+		player->Post([player]() {
+					player->Flush();
+				});
+	}
+}
+
+bool PersistManager::Write()
+{
+	std::unordered_map<int64_t, PlayerSections> pending;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		pending.swap(_pending);
+	}
+
+	if (pending.empty()) return true;
+
+	auto start_time = std::chrono::steady_clock::now();
+
+	Storage::PlayerBatch batch;
+	std::vector<int64_t> failed_list;
+
+	uint64_t written = 0, failed = 0;
+
+	auto it = pending.begin();
+	while (it != pending.end())
+	{
+		batch.emplace(it->first, std::move(it->second));
+		++it;
+
+		if (batch.size() < _batch_size && it != pending.end()) continue;
+
+		StorageInstance.SavePlayers(batch, failed_list);
+
+		written += batch.size() - failed_list.size();
+		failed += failed_list.size();
+
+		if (failed_list.size())
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			for (auto player_id : failed_list)
+			{
+				auto& requeue = _pending[player_id]; //重新排队，已经有新数据的段不覆盖
+				for (auto& section : batch[player_id]) requeue.emplace(section.first, std::move(section.second));
+			}
+		}
+
+		batch.clear();
+	}
+
+	int64_t flush_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count();
+
+	++_flush_count;
+	_written_total += written;
+	_failed_total += failed;
+	_last_flush_time = flush_time;
+	if (flush_time > _max_flush_time) _max_flush_time = flush_time;
+
+	if (failed) CP("%s:line:%d persist write failed, count:%lu", __func__, __LINE__, failed);
+
+	return failed == 0;
+}
+
+void PersistManager::Report()
+{
+	size_t dirty_size = 0, pending_size = 0;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		dirty_size = _dirty.size();
+		pending_size = _pending.size();
+	}
+
+	std::string content = "persist dirty:" + std::to_string(dirty_size) + " pending:" + std::to_string(pending_size) +
+		" flush_count:" + std::to_string(_flush_count) + " written:" + std::to_string(_written_total) +
+		" failed:" + std::to_string(_failed_total) + " throttled:" + std::to_string(_throttled_total) +
+		" last_flush_ms:" + std::to_string(_last_flush_time) + " max_flush_ms:" + std::to_string(_max_flush_time);
+
+	auto log = make_unique<Asset::LogMessage>();
+	log->set_type(Asset::SYSTEM);
+	log->set_content(content);
+
+	LOG(INFO, log.get());
+}
+
+}
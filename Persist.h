@@ -0,0 +1,88 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <string>
+#include <condition_variable>
+#include <unordered_map>
+
+#include "PlayerStorage.h"
+
+namespace Adoter
+{
+
+class Player;
+
+/*
+ * 类说明：
+ *
+ * 延迟存盘(WRITE-BEHIND)：玩家数据变化时只做标记，存盘线程定期合并写入数据库.
+ *
+ * 流程：标记脏数据 -> 在玩家邮箱中序列化(快照) -> 存盘线程批量写入(PIPELINE).
+ *
+ * 同一玩家多次修改只写最后一次，只写有变化的段；玩家的所有写入都经过存盘线程，不会被旧数据覆盖.
+ *
+ * 配置：
+ *
+ * PersistFlushInterval：存盘周期(MS)，默认5000；脏数据最长约两个周期写入数据库.
+ *
+ * PersistBatchSize：每批写入数量，默认200；脏数据达到该数量时提前存盘.
+ *
+ * PersistMaxPending：等待写入的快照上限，默认5000；超出后暂停快照，玩家保持脏标记(背压).
+ *
+ * */
+
+class PersistManager
+{
+private:
+	std::mutex _mutex;
+	std::condition_variable _condition;
+	std::shared_ptr<std::thread> _thread;
+	bool _stopped = true;
+	bool _urgent = false; //有需要立即写入的数据(下线存盘)
+
+	std::unordered_map<int64_t, std::weak_ptr<Player>> _dirty; //等待快照
+	std::unordered_map<int64_t, PlayerSections> _pending; //已经快照，等待写入
+
+	int32_t _flush_interval = 5000;
+	size_t _batch_size = 200;
+	size_t _max_pending = 5000;
+
+	//统计
+	std::atomic<uint64_t> _flush_count{0}; //存盘次数
+	std::atomic<uint64_t> _written_total{0}; //写入玩家数
+	std::atomic<uint64_t> _failed_total{0}; //写入失败数
+	std::atomic<uint64_t> _throttled_total{0}; //背压暂停次数
+	std::atomic<int64_t> _last_flush_time{0}; //最近一次存盘耗时(MS)
+	std::atomic<int64_t> _max_flush_time{0}; //最长存盘耗时(MS)
+private:
+	void Run();
+	void Snapshot(); //通知脏玩家在自己的邮箱中序列化
+	bool Write(); //写入所有快照，有失败返回false
+public:
+	static PersistManager& Instance()
+	{
+		static PersistManager _instance;
+		return _instance;
+	}
+
+	void Load();
+	void Start();
+	//停止存盘线程：写完已有快照后返回
+	void Stop();
+	bool IsRunning();
+
+	//标记脏数据：同一玩家只记录一次
+	void SetDirty(std::shared_ptr<Player> player);
+	//快照：合并到同一玩家未写入的快照，相同的段覆盖，urgent为立即写入
+	void Enqueue(int64_t player_id, PlayerSections sections, bool urgent = false);
+
+	//统计日志
+	void Report();
+};
+
+#define PersistInstance PersistManager::Instance()
+
+}
@@ -1,7 +1,5 @@
 #include <iostream>
 
-#include <hiredis.h>
-
 #include "Player.h"
 #include "Game.h"
 #include "Timer.h"
@@ -9,11 +7,14 @@
 #include "Player.h"
 #include "Protocol.h"
 #include "CommonUtil.h"
-#include "RedisManager.h"
+#include "Storage.h"
+#include "Persist.h"
+#include "RecordCache.h"
 #include "PlayerCommonReward.h"
 #include "PlayerCommonLimit.h"
 #include "MessageFormat.h"
 #include "PlayerMatch.h"
+#include "ProtocolTrace.h"
 
 namespace Adoter
 {
@@ -22,21 +23,6 @@ extern const Asset::CommonConst* g_const;
 
 Player::Player()
 {
-	//协议默认处理函数
-	_method = std::bind(&Player::DefaultMethod, this, std::placeholders::_1);
-
-	//协议处理回调初始化
-	AddHandler(Asset::META_TYPE_SHARE_CREATE_ROOM, std::bind(&Player::CmdCreateRoom, this, std::placeholders::_1));
-	AddHandler(Asset::META_TYPE_SHARE_GAME_OPERATION, std::bind(&Player::CmdGameOperate, this, std::placeholders::_1));
-	AddHandler(Asset::META_TYPE_SHARE_PAI_OPERATION, std::bind(&Player::CmdPaiOperate, this, std::placeholders::_1));
-	AddHandler(Asset::META_TYPE_SHARE_BUY_SOMETHING, std::bind(&Player::CmdBuySomething, this, std::placeholders::_1));
-	AddHandler(Asset::META_TYPE_SHARE_ENTER_ROOM, std::bind(&Player::CmdEnterRoom, this, std::placeholders::_1));
-	AddHandler(Asset::META_TYPE_SHARE_SIGN, std::bind(&Player::CmdSign, this, std::placeholders::_1));
-
-	//AddHandler(Asset::META_TYPE_C2S_LOGIN, std::bind(&Player::CmdLogin, this, std::placeholders::_1));
-	//AddHandler(Asset::META_TYPE_C2S_ENTER_GAME, std::bind(&Player::CmdEnterGame, this, std::placeholders::_1));
-	AddHandler(Asset::META_TYPE_C2S_GET_REWARD, std::bind(&Player::CmdGetReward, this, std::placeholders::_1));
-	AddHandler(Asset::META_TYPE_C2S_LOAD_SCENE, std::bind(&Player::CmdLoadScene, this, std::placeholders::_1));
 }
 
 Player::Player(int64_t player_id, std::shared_ptr<WorldSession> session) : Player()/*委派构造函数*/
@@ -45,11 +31,60 @@ Player::Player(int64_t player_id, std::shared_ptr<WorldSession> session) : Playe
 	this->_session = session; //地址拷贝
 }
 
-int32_t Player::Load()
+void Player::Load(std::function<void(int32_t)> callback)
+{
+	std::string stuff;
+	if (RecordCacheInstance.Take(PlayerStorage::GetLegacyKey(GetID()), stuff)) //最近下线，缓存中的数据与数据库一致
+	{
+		//摘要按缓存中的原始数据计算，加载时的修正(货币流水、新增包裹)仍会存盘
+		Asset::Player cached;
+		cached.ParseFromString(stuff);
+
+		PlayerSections sections;
+		PlayerStorage::Split(cached, sections);
+
+		_section_hash.clear();
+		for (const auto& section : sections) _section_hash.emplace(section.first, std::hash<std::string>()(section.second));
+
+		int32_t result = OnLoad(stuff);
+		if (callback) callback(result);
+		return;
+	}
+
+	if (!_session) //不在线：直接读取
+	{
+		std::vector<PlayerRecord> records;
+		StorageInstance.LoadPlayers({GetID()}, records);
+
+		int32_t result = OnLoad(records[0]);
+		if (callback) callback(result);
+		return;
+	}
+
+	//加载数据库：异步读取，回调在玩家邮箱中执行
+	auto self = shared_from_this();
+	StorageInstance.LoadPlayer(_session->GetStream().get_io_service(), GetID(), 
+			_session->GetMailbox().Wrap([self, callback](const PlayerRecord& record) {
+				int32_t result = self->OnLoad(record);
+				if (callback) callback(result);
+			}));
+}
+
+int32_t Player::OnLoad(const PlayerRecord& record)
+{
+	if (!record.success) return 1;
+
+	//记录已存数据的摘要，没有修改的段不再写入；旧数据为空，首次存盘写入所有段
+	_section_hash.clear();
+	for (const auto& section : record.sections) _section_hash.emplace(section.first, std::hash<std::string>()(section.second));
+
+	return OnLoad(record.stuff);
+}
+
+int32_t Player::OnLoad(const std::string& stuff)
 {
-	//加载数据库
-	std::shared_ptr<Redis> redis = std::make_shared<Redis>();
-	std::string stuff = redis->GetPlayer(GetID()); //不能用引用
+	_loaded = true;
+
 	if (stuff == "")
 	{
 		std::cout << __func__ << " error, not found player_id:" << GetID() << std::endl;
@@ -57,6 +92,8 @@ int32_t Player::Load()
 	}
 	//初始化结构数据
 	this->_stuff.ParseFromString(stuff);
+	//货币以流水为准：上次停服前的变化可能还没有存盘
+	LedgerInstance.Restore(GetID(), _stuff.mutable_common_prop());
 	//初始化包裹，创建角色或者增加包裹会调用一次
 	do {
 		const pb::EnumDescriptor* enum_desc = Asset::INVENTORY_TYPE_descriptor();
@@ -76,18 +113,90 @@ int32_t Player::Load()
 	return 0;
 }
 
+void Player::GetSections(PlayerSections& sections, bool all)
+{
+	PlayerStorage::Split(_stuff, sections);
+
+	auto it = sections.begin();
+	while (it != sections.end())
+	{
+		size_t hash = std::hash<std::string>()(it->second);
+
+		auto& saved_hash = _section_hash[it->first];
+		if (!all && saved_hash == hash && hash != 0) 
+		{
+			it = sections.erase(it); //没有变化
+			continue;
+		}
+
+		saved_hash = hash;
+		++it;
+	}
+}
+
 int32_t Player::Save()
 {
-	//存入数据库
-	std::string stuff = this->_stuff.SerializeAsString();
+	if (!_loaded) return 1; //数据还没加载，不能覆盖数据库
+
+	_dirty = false;
+
+	//存入数据库：只写有变化的段
+	PlayerSections sections;
+	GetSections(sections);
+
+	if (sections.empty()) return 0;
+
+	if (_session && PersistInstance.IsRunning()) 
+	{
+		PersistInstance.Enqueue(GetID(), std::move(sections), true); //由存盘线程立即写入，不会被旧快照覆盖
+		return 0;
+	}
+
+	if (_session) 
+	{
+		std::vector<std::string> names; //写入失败时这些段的摘要作废，下次存盘重新写入
+		for (const auto& section : sections) names.push_back(section.first);
+
+		auto self = shared_from_this();
+		StorageInstance.SavePlayer(_session->GetStream().get_io_service(), GetID(), sections, 
+				_session->GetMailbox().Wrap([self, names](bool success) {
+					if (success) return;
+
+					for (const auto& name : names) self->_section_hash.erase(name);
+					self->SetDirty();
+				}));
+		return 0;
+	}
 
-	auto redis = make_unique<Redis>();
+	RecordCacheInstance.Erase(PlayerStorage::GetLegacyKey(GetID())); //不在线修改，缓存失效
 
-	redis->SavePlayer(GetID(), stuff);
+	std::vector<int64_t> failed;
+	StorageInstance.SavePlayers({{GetID(), sections}}, failed);
 
 	return 0;
 }
 	
+void Player::SetDirty()
+{
+	if (!_loaded || _dirty) return; //已经标记过，等待快照
+
+	_dirty = true;
+
+	PersistInstance.SetDirty(shared_from_this());
+}
+
+void Player::Flush()
+{
+	if (!_loaded || !_dirty) return; //已经存盘
+
+	_dirty = false;
+
+	PlayerSections sections;
+	GetSections(sections); //只写有变化的段
+
+	PersistInstance.Enqueue(GetID(), std::move(sections));
+}
+
 std::string Player::GetString()
 {
 	::google::protobuf::MessageFormat::Printer printer;
@@ -102,24 +211,36 @@ std::string Player::GetString()
 
 int32_t Player::OnLogin(pb::Message* message)
 {
-	if (Load()) return 1;
+	auto self = shared_from_this();
+	Load([self](int32_t result) {
+				if (result) return;
 
-	SendPlayer(); //发送数据给Client
-	
-	this->_stuff.set_login_time(CommonTimerInstance.GetTime());
-	this->_stuff.set_logout_time(0);
+				self->SendPlayer(); //发送数据给Client
+
+				self->ScheduleUpdate(); //开始定时任务
+				
+				self->_stuff.set_login_time(CommonTimerInstance.GetTime());
+				self->_stuff.set_logout_time(0);
+			});
 
 	return 0;
 }
 
 int32_t Player::OnLogout(pb::Message* message)
 {
+	CancelUpdate(); //停止定时任务
+
 	if (_locate_room) 
 	{
 		Asset::GameOperation game_operate;
 		game_operate.set_source_player_id(GetID()); //设置当前操作玩家
 		game_operate.set_oper_type(Asset::GAME_OPER_TYPE_LEAVE); //离开游戏，退出房间
-		_locate_room->OnPlayerOperate(shared_from_this(), &game_operate); //广播给其他玩家
+
+		auto room = _locate_room;
+		auto self = shared_from_this();
+		room->Post([room, self, game_operate]() mutable {
+					room->OnPlayerOperate(self, &game_operate); //广播给其他玩家
+				});
 	}
 
 	this->_stuff.set_login_time(0);
@@ -128,6 +249,8 @@ int32_t Player::OnLogout(pb::Message* message)
 	this->_stuff.mutable_player_prop()->Clear(); 
 	//存档数据库
 	Save();	
+	//缓存：短时间内重连不再读取数据库
+	if (_loaded) RecordCacheInstance.Put(PlayerStorage::GetLegacyKey(GetID()), this->_stuff.SerializeAsString());
 	//日志
 	auto log = make_unique<Asset::LogMessage>();
 	log->set_player_id(GetID());
@@ -156,12 +279,22 @@ int32_t Player::CmdEnterGame(pb::Message* message)
 
 int32_t Player::OnEnterGame() 
 {
-	if (Load()) return 1;
-
-	SendPlayer(); //发送数据给玩家
-	
-	this->_stuff.set_login_time(CommonTimerInstance.GetTime());
-	this->_stuff.set_logout_time(0);
+	auto self = shared_from_this();
+	Load([self](int32_t result) {
+				if (result) 
+				{
+					CP("Load player failed, player_id:%ld", self->GetID());
+					if (self->_session) self->_session->KillOutPlayer(); //数据库出错，不能进入游戏
+					return;
+				}
+
+				self->SendPlayer(); //发送数据给玩家
+
+				self->ScheduleUpdate(); //开始定时任务
+				
+				self->_stuff.set_login_time(CommonTimerInstance.GetTime());
+				self->_stuff.set_logout_time(0);
+			});
 	
 	return 0;
 }
@@ -186,7 +319,11 @@ int32_t Player::CmdCreateRoom(pb::Message* message)
 	if (!create_room) return 1;
 
 	int64_t room_id = RoomInstance.CreateRoom();
-	if (!room_id) return 2;
+	if (!room_id) 
+	{
+		AlertMessage(Asset::ERROR_INNER); //房间ID暂时分配失败
+		return 2;
+	}
 
 	create_room->mutable_room()->set_room_id(room_id);
 	create_room->mutable_room()->set_room_type(Asset::ROOM_TYPE_FRIEND); //创建房间，其实是好友房
@@ -222,46 +359,58 @@ int32_t Player::CmdGameOperate(pb::Message* message)
 
 	game_operate->set_source_player_id(GetID()); //设置当前操作玩家
 
-	switch(game_operate->oper_type())
-	{
-		case Asset::GAME_OPER_TYPE_START: //开始游戏：相当于准备
-		case Asset::GAME_OPER_TYPE_LEAVE: //离开游戏：相当于退出房间
-		{
-			_stuff.mutable_player_prop()->set_game_oper_state(game_operate->oper_type());
-		}
-		break;
+	//准备状态、房主检查都在房间中处理：协议对象由对象池回收，需要复制
+	auto room = _locate_room;
+	auto self = shared_from_this();
+	Asset::GameOperation operate(*game_operate);
+	room->Post([room, self, operate]() mutable {
+				room->OnPlayerOperate(self, &operate); //广播给其他玩家
+			});
 
-		case Asset::GAME_OPER_TYPE_KICKOUT: //踢人
+	return 0;
+}
+
+int32_t Player::CmdPaiOperate(pb::Message* message)
+{
+	Asset::PaiOperation* pai_operate = dynamic_cast<Asset::PaiOperation*>(message);
+	if (!pai_operate) return 1; 
+
+	if (!_locate_room) return 2; //还没加入房间
+
+	switch (pai_operate->oper_type())
+	{
+		case Asset::PaiOperation_PAI_OPER_TYPE_PAI_OPER_TYPE_XUANFENG_FENG: //旋风杠
+		case Asset::PaiOperation_PAI_OPER_TYPE_PAI_OPER_TYPE_XUANFENG_JIAN: //旋风杠
 		{
-			if (!_locate_room->IsHoster(GetID())) //不是房主，不能踢人
+			if (_stuff.player_prop().pai_oper_count() >= 2) 
 			{
-				AlertMessage(Asset::ERROR_ROOM_NO_PERMISSION); //没有权限
-				return 3;
+				P(Asset::ERROR, "%s:line:%d, player:%ld 检查旋风杠，估计外挂行为.", __func__, __LINE__, GetID());
+				return 4;
 			}
 		}
 		break;
-		
-		case Asset::GAME_OPER_TYPE_NULL: 
+
 		default:
 		{
-			 _stuff.mutable_player_prop()->clear_game_oper_state();
 		}
 		break;
 	}
 
-	_locate_room->OnPlayerOperate(shared_from_this(), message); //广播给其他玩家
+	//牌局数据属于房间，在房间中处理：协议对象由对象池回收，需要复制
+	auto self = shared_from_this();
+	Asset::PaiOperation operate(*pai_operate);
+	_locate_room->Post([self, operate]() mutable {
+				self->OnPaiOperate(&operate);
+			});
 
 	return 0;
 }
 
-int32_t Player::CmdPaiOperate(pb::Message* message)
+int32_t Player::OnPaiOperate(Asset::PaiOperation* pai_operate)
 {
-	Asset::PaiOperation* pai_operate = dynamic_cast<Asset::PaiOperation*>(message);
-	if (!pai_operate) return 1; 
+	if (!_game) return 2; //还没开始游戏
 
-	if (!_locate_room || !_game) return 2; //还没加入房间或者还没开始游戏
-
-	pai_operate->set_position(GetPosition()); //设置玩家座位
+	pai_operate->set_position(_game->GetPosition(GetID())); //设置玩家座位
 
 	//进行操作
 	switch (pai_operate->oper_type())
@@ -303,22 +452,12 @@ int32_t Player::CmdPaiOperate(pb::Message* message)
 		
 		case Asset::PaiOperation_PAI_OPER_TYPE_PAI_OPER_TYPE_XUANFENG_FENG: //旋风杠
 		{
-			if (_stuff.player_prop().pai_oper_count() >= 2) 
-			{
-				P(Asset::ERROR, "%s:line:%d, player:%ld 检查旋风杠，估计外挂行为.", __func__, __LINE__, GetID());
-				return 4;
-			}
 			OnGangFengPai();
 		}
 		break;
 		
 		case Asset::PaiOperation_PAI_OPER_TYPE_PAI_OPER_TYPE_XUANFENG_JIAN: //旋风杠
 		{
-			if (_stuff.player_prop().pai_oper_count() >= 2) 
-			{
-				P(Asset::ERROR, "%s:line:%d, player:%ld 检查旋风杠，估计外挂行为.", __func__, __LINE__, GetID());
-				return 4;
-			}
 			OnGangJianPai();
 		}
 		break;
@@ -330,9 +469,13 @@ int32_t Player::CmdPaiOperate(pb::Message* message)
 
 	}
 
-	_game->OnPaiOperate(shared_from_this(), message);
+	_game->OnPaiOperate(shared_from_this(), pai_operate);
 
-	_stuff.mutable_player_prop()->set_pai_oper_count(_stuff.player_prop().pai_oper_count() + 1); //玩家操作次数
+	//玩家操作次数：只统计牌局中执行的操作，玩家数据在玩家邮箱中修改
+	auto self = shared_from_this();
+	Post([self]() {
+				self->_stuff.mutable_player_prop()->set_pai_oper_count(self->_stuff.player_prop().pai_oper_count() + 1);
+			});
 
 	return 0;
 }
@@ -441,8 +584,8 @@ int32_t Player::CmdEnterRoom(pb::Message* message)
 				return result;
 			}
 
-			//进入匹配
-			MatchInstance.Join(shared_from_this(), message);
+			//进入匹配：协议对象由对象池回收，需要复制
+			MatchInstance.Join(shared_from_this(), *enter_room);
 		}
 		break;
 
@@ -502,7 +645,12 @@ bool Player::OnEnterRoom(int64_t room_id)
 
 	_locate_room->OnCreated();
 
-	_locate_room->Enter(shared_from_this()); //玩家进入房间
+	auto room = _locate_room;
+	auto self = shared_from_this();
+	Asset::CommonProp common_prop(CommonProp()); //房间中不读取玩家数据，复制一份
+	room->Post([room, self, common_prop]() {
+				room->Enter(self, common_prop); //玩家进入房间
+			});
 
 	return true;
 }
@@ -523,31 +671,34 @@ void Player::SendMessage(Asset::MsgItem& item)
 
 void Player::SendProtocol(pb::Message* message)
 {
+	if (!message) return;
+
 	SendProtocol(*message);
 }
 
 void Player::SendProtocol(pb::Message& message)
 {
-	const pb::FieldDescriptor* field = message.GetDescriptor()->FindFieldByName("type_t");
-	if (!field) return;
-	
-	int type_t = field->default_value_enum()->number();
-	if (!Asset::META_TYPE_IsValid(type_t)) return;	//如果不合法，不检查会宕线
-	
-	Asset::Meta meta;
-	meta.set_type_t((Asset::META_TYPE)type_t);
-	meta.set_stuff(message.SerializeAsString());
+	SendProtocol(ProtocolInstance.GetMetaType(message), message);
+}
 
-	std::string content = meta.SerializeAsString();
-	GetSession()->AsyncSend(content);
-	
+void Player::SendProtocol(int32_t type_t, const pb::Message& message)
+{
+	auto frame = WorldSession::EncodeProtocol(type_t, message);
+	if (!frame) return;
+
+	SendFrame(frame);
 	
-	auto log = make_unique<Asset::LogMessage>();
-	log->set_player_id(GetID());
-	log->set_type(Asset::SEND_PROTOCOL);
-	log->set_content(message.ShortDebugString());
+	if (ProtocolTraceInstance.ShouldTrace(type_t, GetID())) //协议跟踪
+	{
+		ProtocolTraceInstance.Trace(ProtocolTrace::TRACE_DIRECTION_SEND, type_t, GetID(), message);
+	}
+}
 
-	LOG(INFO, log.get()); //记录日志
+void Player::SendFrame(std::shared_ptr<const std::string> frame)
+{
+	if (!_session) return;
+
+	_session->AsyncSendFrame(frame);
 }
 
 /*
@@ -573,42 +724,55 @@ void Player::SendToRoomers(pb::Message& message)
 {
 }
 */
-//玩家心跳周期为10MS，如果该函数返回FALSE则表示掉线
+//玩家定时任务，周期为1MIN
 bool Player::Update()
 {
 	++_heart_count; //心跳
 
-	if (_heart_count % 6000 == 0) //1MIN
-	{
-		std::cout << "===================Time has gone 1min, i am id:" << GetID() << std::endl;
-		CommonLimitUpdate(); //通用限制,定时更新
-	}
+	CommonLimitUpdate(); //通用限制,定时更新
+
 	return true;
 }
-	
-int32_t Player::DefaultMethod(pb::Message* message)
+
+void Player::ScheduleUpdate()
 {
-	const pb::FieldDescriptor* field = message->GetDescriptor()->FindFieldByName("type_t");
-	if (!field) 
+	if (!_session) return;
+
+	if (!_update_timer) _update_timer = std::make_shared<boost::asio::deadline_timer>(_session->GetStream().get_io_service());
+
+	_update_timer->expires_from_now(boost::posix_time::minutes(1));
+
+	std::weak_ptr<Player> weak_player = shared_from_this(); //定时器不延长玩家生命周期
+	_update_timer->async_wait(_session->GetMailbox().Wrap([weak_player](const boost::system::error_code& error) {
+				if (error) return; //已取消
+
+				auto player = weak_player.lock();
+				if (!player) return;
+
+				player->Update();
+				player->ScheduleUpdate();
+			}));
+}
+
+void Player::Post(std::function<void()> task)
+{
+	if (!_session) 
 	{
-		std::cout << __func__ << ":Could not found type_t of received message." << std::endl;
-		return 1;
+		task(); //不在线，没有其他线程修改
+		return;
 	}
-	const pb::EnumValueDescriptor* enum_value = message->GetReflection()->GetEnum(*message, field);
-	if (!enum_value) return 2;
 
-	const std::string& enum_name = enum_value->name();
-	std::cout << __func__ << ":Could not found call back, message type is: " << enum_name.c_str() << std::endl;
-	return 0;
+	_session->GetMailbox().Post(std::move(task));
 }
 
-bool Player::HandleProtocol(int32_t type_t, pb::Message* message)
+void Player::CancelUpdate()
 {
-	CallBack& callback = GetMethod(type_t); 
-	callback(std::forward<pb::Message*>(message));	
-	return true;
-}
+	if (!_update_timer) return;
 
+	boost::system::error_code error;
+	_update_timer->cancel(error);
+}
+	
 bool Player::GainItem(int64_t global_item_id, int32_t count)
 {
 	pb::Message* asset_item = AssetInstance.Get(global_item_id); //此处取出来的必然为合法ITEM.
@@ -643,6 +807,8 @@ bool Player::PushBackItem(Asset::INVENTORY_TYPE inventory_type, Item* item)
 	auto item_toadd = inventory->mutable_items()->Add();
 	item_toadd->CopyFrom(item->GetCommonProp());
 
+	SetDirty();
+
 	return true;
 }
 
@@ -693,7 +859,11 @@ bool Player::IsCommonLimit(int64_t global_id)
 bool Player::CommonLimitUpdate()
 {
 	bool updated = CommonLimitInstance.Update(shared_from_this());
-	if (updated) SyncCommonLimit();
+	if (updated) 
+	{
+		SyncCommonLimit();
+		SetDirty();
+	}
 
 	return updated;
 }
@@ -709,7 +879,11 @@ void Player::SyncCommonLimit()
 bool Player::DeliverReward(int64_t global_id)
 {
 	bool delivered = CommonRewardInstance.DeliverReward(shared_from_this(), global_id);
-	if (delivered) SyncCommonReward(global_id);
+	if (delivered) 
+	{
+		SyncCommonReward(global_id);
+		SetDirty();
+	}
 	
 	return delivered;
 }
@@ -807,20 +981,20 @@ void Player::SyncCommonProperty()
 	common_prop.mutable_common_prop()->CopyFrom(GetCommonProp());
 }
 
-bool Player::CmdBuySomething(pb::Message* message)
+int32_t Player::CmdBuySomething(pb::Message* message)
 {
 	auto some_thing = dynamic_cast<Asset::BuySomething*>(message);
-	if (some_thing) return false;
+	if (!some_thing) return 1;
 
 	int64_t mall_id = some_thing->mall_id();
-	if (mall_id <= 0) return false;
+	if (mall_id <= 0) return 2;
 
 	auto ret = MallInstance.BuySomething(shared_from_this(), mall_id);
 	some_thing->set_result(ret);
 
 	SendProtocol(some_thing); //返回给Client
 
-	return true;
+	return 0;
 }
 
 int32_t Player::CmdLoadScene(pb::Message* message)
@@ -855,7 +1029,11 @@ int32_t Player::CmdLoadScene(pb::Message* message)
 
 			_locate_room = locate_room;
 
-			_locate_room->Enter(shared_from_this()); //玩家进入房间
+			auto self = shared_from_this();
+			Asset::CommonProp common_prop(CommonProp()); //房间中不读取玩家数据，复制一份
+			locate_room->Post([locate_room, self, common_prop]() {
+						locate_room->Enter(self, common_prop); //玩家进入房间
+					});
 			
 			_stuff.mutable_player_prop()->clear_load_type(); //状态
 			_stuff.mutable_player_prop()->clear_room_id(); //状态
@@ -1046,7 +1224,9 @@ bool Player::CheckHuPai(const Asset::PaiElement& pai)
 		std::sort(card.second.begin(), card.second.end(), [](int x, int y){ return x < y; }); //由小到大，排序
 
 	////////////////////////////////////////////////////////////////////////////是否可以胡牌的前置检查
-	auto options = _locate_room->GetOptions();
+	if (!_game || !_game->GetRoom()) return false;
+
+	auto options = _game->GetRoom()->GetOptions(); //牌局所在的房间：房间邮箱中不读取玩家的房间
 	//是否可以缺门
 	auto it_duanmen = std::find(options.extend_type().begin(), options.extend_type().end(), Asset::ROOM_EXTEND_TYPE_DUANMEN);
 	if (it_duanmen != options.extend_type().end()) 
@@ -1385,27 +1565,27 @@ bool Player::CheckMingGangPai(const Asset::PaiElement& pai)
 	
 bool Player::CheckFengGangPai() 
 { 
-	if (_stuff.player_prop().check_feng_gang()) return false;
+	if (_checked_fenggang) return false;
 
-	_stuff.mutable_player_prop()->set_check_feng_gang(true); //设置已经检查过旋风杠
+	_checked_fenggang = true; //设置已经检查过旋风杠
 
 	return CheckFengGangPai(_cards); 
 }
 
 bool Player::CheckJianGangPai() 
 { 
-	if (_stuff.player_prop().check_jian_gang()) return false;
+	if (_checked_jiangang) return false;
 
-	_stuff.mutable_player_prop()->set_check_jian_gang(true); //设置已经检查过旋风杠
+	_checked_jiangang = true; //设置已经检查过旋风杠
 
 	return CheckJianGangPai(_cards); 
 }
 
 bool Player::CheckFengGangPai(std::map<int32_t/*麻将牌类型*/, std::vector<int32_t>/*牌值*/>& cards)
 {
-	if (!_locate_room) return false;
+	if (!_game || !_game->GetRoom()) return false;
 
-	auto options = _locate_room->GetOptions();
+	auto options = _game->GetRoom()->GetOptions();
 
 	auto it_xuanfeng = std::find(options.extend_type().begin(), options.extend_type().end(), Asset::ROOM_EXTEND_TYPE_XUANFENGGANG);
 	if (it_xuanfeng == options.extend_type().end()) return false; //不支持
@@ -1442,9 +1622,9 @@ void Player::OnGangFengPai()
 
 bool Player::CheckJianGangPai(std::map<int32_t/*麻将牌类型*/, std::vector<int32_t>/*牌值*/>& cards)
 {
-	if (!_locate_room) return false;
+	if (!_game || !_game->GetRoom()) return false;
 
-	auto options = _locate_room->GetOptions();
+	auto options = _game->GetRoom()->GetOptions();
 
 	auto it_xuanfeng = std::find(options.extend_type().begin(), options.extend_type().end(), Asset::ROOM_EXTEND_TYPE_XUANFENGGANG);
 	if (it_xuanfeng == options.extend_type().end()) return false; //不支持
@@ -1650,4 +1830,30 @@ void PlayerManager::Erase(Player& player)
 	_entities.erase(player.GetID());
 }
 
+void PlayerManager::SaveAll()
+{
+	std::vector<std::shared_ptr<Player>> players;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		for (const auto& entity : _entities) players.push_back(entity.second);
+	}
+
+	Storage::PlayerBatch batch;
+	std::vector<int64_t> online_players; //在线玩家列表，启动时预热缓存
+
+	for (auto player : players) 
+	{
+		if (!player->IsLoaded()) continue;
+
+		player->GetSections(batch[player->GetID()], true); //写入所有段
+		online_players.push_back(player->GetID());
+	}
+
+	std::vector<int64_t> failed;
+	if (!StorageInstance.SavePlayers(batch, failed)) CP("%s:line:%d save players failed, count:%lu", __func__, __LINE__, failed.size());
+	else std::cout << __func__ << " success, count:" << batch.size() << std::endl;
+
+	StorageInstance.SetOnlinePlayers(online_players);
+}
+
 }
@@ -12,43 +12,31 @@
 #include "Asset.h"
 #include "WorldSession.h"
 #include "MessageDispatcher.h"
+#include "PlayerStorage.h"
+#include "CurrencyLedger.h"
 
 namespace Adoter
 {
 namespace pb = google::protobuf;
 
 class Room;
+struct PlayerRecord;
 class Game;
 
 class Player : public std::enable_shared_from_this<Player>
 {
-	typedef std::function<int32_t(pb::Message*)> CallBack;
-	std::unordered_map<int32_t, CallBack>  _callbacks;	//每个协议的回调函数，不要传入引用
 private:
 	Asset::Player _stuff; //玩家数据
 	int64_t _heart_count = 0; //心跳次数
+	bool _loaded = false; //数据已经从数据库加载
+	bool _dirty = false; //数据有变化，等待存盘线程快照
+	std::unordered_map<std::string, size_t> _section_hash; //每段最近一次存盘的数据摘要，没有变化的段不写
 
-	CallBack _method;
 	std::shared_ptr<WorldSession> _session = nullptr;	//网络连接
+	std::shared_ptr<boost::asio::deadline_timer> _update_timer = nullptr; //定时任务，在网络线程触发
 public:
 	Player();
 	Player(int64_t player_id, std::shared_ptr<WorldSession> session);
-	//协议处理默认调用函数
-	int32_t DefaultMethod(pb::Message*);
-	
-	void AddHandler(Asset::META_TYPE message_type, CallBack callback)
-	{
-		if (_callbacks.find(message_type) != _callbacks.end()) return;
-
-		_callbacks.emplace(message_type, callback);
-	}
-
-	CallBack& GetMethod(int32_t message_type)
-	{
-		auto it = _callbacks.find(message_type);
-		if (it == _callbacks.end()) return _method;
-		return it->second;
-	}
 
 	//获取玩家数据
 	Asset::Player& Get() { return _stuff; }
@@ -72,10 +60,14 @@ public:
 	virtual bool HandleMessage(const Asset::MsgItem& item); 
 	virtual void SendMessage(Asset::MsgItem& item);
 	virtual void BroadCastCommonProp(Asset::MSG_TYPE type); //向房间里的玩家发送公共数据       
-	//协议处理(Protocol Buffer)
-	virtual bool HandleProtocol(int32_t type_t, pb::Message* message);
+	//协议处理(Protocol Buffer)：处理函数见WorldSession::RegisterHandlers
 	virtual void SendProtocol(pb::Message& message);
 	virtual void SendProtocol(pb::Message* message);
+	//具体协议：编译期确定类型，不做反射查找
+	template<class T> void SendProtocol(const T& message) { SendProtocol(MetaTypeTraits<T>::Type(), message); }
+	template<class T> void SendProtocol(T* message) { if (message) SendProtocol(*message); }
+	virtual void SendProtocol(int32_t type_t, const pb::Message& message);
+	virtual void SendFrame(std::shared_ptr<const std::string> frame); //发送已打包的数据，广播共用
 	//virtual void SendResponse(pb::Message* message);
 	//virtual void SendToRoomers(pb::Message& message); //向房间里玩家发送协议数据，发送到客户端
 	virtual void BroadCast(Asset::MsgItem& item);
@@ -89,6 +81,7 @@ public:
 	//进入房间
 	virtual int32_t CmdEnterRoom(pb::Message* message);
 	virtual bool OnEnterRoom(int64_t room_id = 0);
+	void OnEnterRoomFailed() { _locate_room = nullptr; } //房间已满等
 	//玩家登录
 	virtual int32_t OnLogin(pb::Message* message);
 	//玩家登出
@@ -96,16 +89,28 @@ public:
 	//离开房间
 	virtual int32_t CmdLeaveRoom(pb::Message* message);
 	virtual void OnLeaveRoom();
-	//加载数据	
-	virtual int32_t Load();
+	//加载数据：异步读取，完成后在玩家邮箱中回调，返回0为成功
+	virtual void Load(std::function<void(int32_t)> callback);
+	int32_t OnLoad(const PlayerRecord& record);
+	int32_t OnLoad(const std::string& stuff);
+	//有变化的数据段，all为所有段
+	void GetSections(PlayerSections& sections, bool all = false);
+	bool IsLoaded() { return _loaded; }
+	void SetLoaded() { _loaded = true; }
 	//保存数据
 	virtual int32_t Save();
+	//标记数据变化：由存盘线程延迟写入
+	void SetDirty();
+	//存盘线程通知：数据有变化则快照，在玩家邮箱中执行
+	void Flush();
 	//同步玩家数据
 	virtual void SendPlayer();
-	//玩家心跳周期为10MS，如果该函数返回FALSE则表示掉线
+	//玩家定时任务，周期为1MIN，空闲玩家没有其他开销
 	virtual bool Update();
+	void ScheduleUpdate();
+	void CancelUpdate();
 	//购买商品
-	virtual bool CmdBuySomething(pb::Message* message);
+	virtual int32_t CmdBuySomething(pb::Message* message);
 	//在线状态
 	void SetOnline(bool online) { _stuff.mutable_player_prop()->set_online(online);	}
 	bool IsOnline() { return _stuff.player_prop().online(); }
@@ -139,28 +144,34 @@ public:
 	{
 		return _session;
 	}
+	//投递到玩家邮箱：其他实体(房间、消息分发)修改玩家数据必须通过此接口
+	void Post(std::function<void()> task);
 	//发送错误信息
 	void AlertMessage(Asset::ERROR_CODE error_code, Asset::ERROR_TYPE error_type = Asset::ERROR_TYPE_NORMAL, Asset::ERROR_SHOW_TYPE error_show_type = Asset::ERROR_SHOW_TYPE_CHAT);
 
 	//消费欢乐豆：返回实际消耗的欢乐豆数
-	int64_t ConsumeHuanledou(int64_t count)
+	int64_t ConsumeHuanledou(int64_t count, Asset::CURRENCY_REASON reason = Asset::CURRENCY_REASON_UNKNOWN)
 	{
 		if (count <= 0) return 0;
 
 		if (!CheckHuanledou(count)) return 0;
 
 		_stuff.mutable_common_prop()->set_huanledou(_stuff.common_prop().huanledou() - count);
+
+		LedgerInstance.Record(GetID(), Asset::CURRENCY_TYPE_HUANLEDOU, -count, GetHuanledou(), reason); //流水
 		
 		SyncCommonProperty();
 		
 		return count;
 	}
 	//增加欢乐豆
-	int64_t IncreaseHuanledou(int64_t count)
+	int64_t IncreaseHuanledou(int64_t count, Asset::CURRENCY_REASON reason = Asset::CURRENCY_REASON_UNKNOWN)
 	{
 		if (count <= 0) return 0;
 
 		_stuff.mutable_common_prop()->set_huanledou(_stuff.common_prop().huanledou() + count);
+
+		LedgerInstance.Record(GetID(), Asset::CURRENCY_TYPE_HUANLEDOU, count, GetHuanledou(), reason);
 		
 		SyncCommonProperty();
 		
@@ -178,25 +189,29 @@ public:
 	int64_t GetDiamond() { return _stuff.common_prop().diamond(); }
 
 	//消费钻石：返回实际消耗的钻石数
-	int64_t ConsumeDiamond(int64_t count)
+	int64_t ConsumeDiamond(int64_t count, Asset::CURRENCY_REASON reason = Asset::CURRENCY_REASON_UNKNOWN)
 	{
 		if (count <= 0) return 0;
 
 		if (!CheckDiamond(count)) return 0;
 
 		_stuff.mutable_common_prop()->set_diamond(_stuff.common_prop().diamond() - count);
+
+		LedgerInstance.Record(GetID(), Asset::CURRENCY_TYPE_DIAMOND, -count, GetDiamond(), reason);
 		
 		SyncCommonProperty();
 		
 		return count;
 	}
 	//增加钻石
-	int64_t IncreaseDiamond(int64_t count)
+	int64_t IncreaseDiamond(int64_t count, Asset::CURRENCY_REASON reason = Asset::CURRENCY_REASON_UNKNOWN)
 	{
-		if (count >= 0) return 0;
+		if (count <= 0) return 0;
 
 		_stuff.mutable_common_prop()->set_diamond(_stuff.common_prop().diamond() + count);
 
+		LedgerInstance.Record(GetID(), Asset::CURRENCY_TYPE_DIAMOND, count, GetDiamond(), reason);
+
 		SyncCommonProperty();
 		
 		return count;
@@ -222,7 +237,7 @@ public:
 	//通用奖励
 	bool DeliverReward(int64_t global_id);
 	void SyncCommonReward(int64_t common_reward_id);
-///////游戏逻辑定义
+///////游戏逻辑定义：牌局数据(牌、杠、当前游戏)属于房间，只在房间邮箱中修改
 private:
 	std::shared_ptr<Room> _locate_room = nullptr; //实体所在房间
 	std::shared_ptr<Game> _game = nullptr; //当前游戏
@@ -232,10 +247,13 @@ private:
 	std::vector<Asset::PaiElement> _angang; //暗杠
 	int32_t _jiangang = 0; //旋风杠，本质是明杠
 	int32_t _fenggang = 0; //旋风杠，本质是暗杠
+	bool _checked_fenggang = false; //本局已经检查过旋风杠
+	bool _checked_jiangang = false; //本局已经检查过箭杠
 public:
 	//玩家操作
 	virtual int32_t CmdGameOperate(pb::Message* message); //游戏操作
 	virtual int32_t CmdPaiOperate(pb::Message* message); //牌操作
+	virtual int32_t OnPaiOperate(Asset::PaiOperation* pai_operate); //牌操作：房间邮箱中执行
 	virtual int32_t CmdGetReward(pb::Message* message); //领取奖励
 	virtual int32_t CmdLoadScene(pb::Message* message); //加载场景
 	virtual int32_t CmdLuckyPlate(pb::Message* message); //幸运转盘
@@ -246,7 +264,7 @@ public:
 	virtual int32_t GetRoomID() { return _stuff.player_prop().room_id(); }
 	virtual bool HasRoom() { return _locate_room != nullptr; }
 
-	void SetGame(std::shared_ptr<Game> game) { _game = game; }
+	void SetGame(std::shared_ptr<Game> game) { _game = game; _checked_fenggang = _checked_jiangang = false; }
 
 	virtual int32_t OnFaPai(std::vector<int32_t>& cards); //发牌
 
@@ -273,17 +291,27 @@ public:
 
 	bool CheckChiPai(const Asset::PaiElement& pai); //是否可以吃牌
 	void OnChiPai(const Asset::PaiElement& pai, pb::Message* message); //吃牌
-	//是否已经在准备状态 
-	bool IsReady() { return _stuff.player_prop().game_oper_state() == Asset::GAME_OPER_TYPE_START; }
-	//获取玩家座次
-	Asset::POSITION_TYPE GetPosition() { return _stuff.player_prop().position(); }
-	void SetPosition(Asset::POSITION_TYPE position) { _stuff.mutable_player_prop()->set_position(position); }
 
 	void SynchronizePai();
 	void PrintPai();
 	void ClearCards() {	_cards.clear();	}
 };
 
+//玩家协议处理：协议表中的统一入口，进入游戏后才处理
+template<int32_t (Player::*method)(pb::Message*)>
+int32_t PlayerHandler(WorldSession* session, pb::Message* message)
+{
+	if (!session->g_player || !session->g_player->IsLoaded()) 
+	{
+		std::cout << __func__ << ":Player has not inited." << std::endl;
+		return 1; //未初始化或者正在加载数据的Player
+	}
+	int32_t result = (session->g_player.get()->*method)(message);
+	if (result == 0) session->g_player->SetDirty(); //处理成功可能修改了数据
+
+	return result;
+}
+
 /////////////////////////////////////////////////////
 //玩家通用管理类
 /////////////////////////////////////////////////////
@@ -305,6 +333,8 @@ public:
 	void Emplace(int64_t entity_id, std::shared_ptr<Player> entity);
 	bool Has(int64_t entity_id);
 	std::shared_ptr<Player> GetPlayer(int64_t id);
+	//所有玩家存盘：一次批量写入，停服时调用
+	void SaveAll();
 };
 
 #define PlayerInstance PlayerManager::Instance()
@@ -44,14 +44,14 @@ public:
 			{
 				case Asset::CommonReward_REWARD_TYPE_REWARD_TYPE_DIAMOND:
 				{
-					player->IncreaseDiamond(count);
+					player->IncreaseDiamond(count, Asset::CURRENCY_REASON_COMMON_REWARD);
 
 				}
 				break;
 
 				case Asset::CommonReward_REWARD_TYPE_REWARD_TYPE_HUANLEDOU:
 				{
-					player->IncreaseHuanledou(count);
+					player->IncreaseHuanledou(count, Asset::CURRENCY_REASON_COMMON_REWARD);
 				}
 				break;
 				
@@ -9,23 +9,33 @@
 namespace Adoter
 {
 	
+PlayerMatch::PlayerMatch() : _mailbox(WorldInstance.GetExecutor())
+{
+}
+
 void PlayerMatch::Update(int32_t diff)
 {
-	_scheduler.Update(diff);
+	_mailbox.Post([this, diff]() {
+				_scheduler.Update(diff);
+			});
 }
 
-void PlayerMatch::Join(std::shared_ptr<Player> player, pb::Message* message)
+void PlayerMatch::Join(std::shared_ptr<Player> player, const Asset::EnterRoom& enter_room)
 {
 	if (!player) return;
 
-	auto player_id = player->GetID();
+	_mailbox.Post([this, player, enter_room]() {
+				OnJoin(player, enter_room);
+			});
+}
 
-	auto enter_room = dynamic_cast<Asset::EnterRoom*>(message);
-	if (!enter_room) return;
+void PlayerMatch::OnJoin(std::shared_ptr<Player> player, const Asset::EnterRoom& enter_room)
+{
+	auto player_id = player->GetID();
 
-	Asset::ROOM_TYPE room_type = enter_room->room().room_type();
+	Asset::ROOM_TYPE room_type = enter_room.room().room_type();
 	
-	auto enter_type = enter_room->enter_type();
+	auto enter_type = enter_room.enter_type();
 		
 	switch (room_type)
 	{
@@ -89,7 +99,11 @@ void PlayerMatch::DoMatch()
 			if (player_list.size() < 4) return;
 				
 			auto room_id = RoomInstance.CreateRoom();
-			if (room_id <= 0) return;
+			if (room_id <= 0) 
+			{
+				task.Repeat(std::chrono::seconds(3)); //房间ID暂时分配失败，稍后继续匹配
+				return;
+			}
 
 			Asset::Room room;
 			room.set_room_id(room_id);
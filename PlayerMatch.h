@@ -7,6 +7,7 @@
 
 #include "P_Header.h"
 #include "TaskScheduler.h"
+#include "Mailbox.h"
 
 namespace Adoter
 {
@@ -21,8 +22,11 @@ class PlayerMatch : public std::enable_shared_from_this<PlayerMatch>
 	std::unordered_map<int64_t, std::shared_ptr<Player>> _dashi;
 
 	TaskScheduler _scheduler;
+	Mailbox _mailbox; //匹配队列和定时匹配都在此执行
 
 public:
+	PlayerMatch();
+
 	static PlayerMatch& Instance()
 	{
 		static PlayerMatch _instance;
@@ -31,7 +35,8 @@ public:
 
 	void Update(int32_t diff);
 
-	void Join(std::shared_ptr<Player> player, pb::Message* message);
+	void Join(std::shared_ptr<Player> player, const Asset::EnterRoom& enter_room); //投递到匹配邮箱
+	void OnJoin(std::shared_ptr<Player> player, const Asset::EnterRoom& enter_room);
 	void DoMatch();
 };
 
@@ -0,0 +1,102 @@
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/wire_format.h>
+
+#include "PlayerStorage.h"
+#include "RedisBatch.h"
+#include "P_Header.h"
+
+namespace Adoter
+{
+
+namespace pb = google::protobuf;
+
+//字段所在的段：消息类型的字段单独一段
+static const std::string& GetSectionName(const pb::FieldDescriptor* field)
+{
+	static const std::string base = "base";
+
+	if (field->type() == pb::FieldDescriptor::TYPE_MESSAGE && !field->is_repeated()) return field->name();
+
+	return base;
+}
+
+void PlayerStorage::Split(const Asset::Player& stuff, PlayerSections& sections)
+{
+	sections.clear();
+
+	stuff.ByteSize(); //计算并缓存长度，编码时需要
+
+	const pb::Descriptor* descriptor = stuff.GetDescriptor();
+	const pb::Reflection* reflection = stuff.GetReflection();
+
+	std::vector<const pb::FieldDescriptor*> fields;
+	reflection->ListFields(stuff, &fields); //只有已设置的字段
+
+	for (auto field : fields)
+	{
+		std::string& section = sections[GetSectionName(field)];
+
+		pb::io::StringOutputStream stream(&section);
+		pb::io::CodedOutputStream output(&stream);
+
+		pb::internal::WireFormat::SerializeFieldWithCachedSizes(field, stuff, &output);
+	}
+
+	//没有设置的段也要写入空数据，覆盖数据库中的旧数据
+	for (int32_t i = 0; i < descriptor->field_count(); ++i) sections[GetSectionName(descriptor->field(i))];
+}
+
+void PlayerStorage::Load(int64_t player_id, RedisBatch& batch)
+{
+	batch.Command({"HGETALL", GetKey(player_id)});
+}
+
+bool PlayerStorage::Merge(const RedisResult& hash, std::string& stuff, PlayerSections& sections)
+{
+	stuff.clear();
+	sections.clear();
+
+	if (!hash.IsArray()) return false;
+
+	for (size_t i = 0; i + 1 < hash.elements.size(); i += 2) //名称和数据交替
+	{
+		stuff += hash.elements[i + 1];
+		sections.emplace(hash.elements[i], hash.elements[i + 1]);
+	}
+
+	return true;
+}
+
+void PlayerStorage::LoadLegacy(int64_t player_id, RedisBatch& batch)
+{
+	batch.Get(GetLegacyKey(player_id));
+}
+
+bool PlayerStorage::MergeLegacy(const RedisResult& legacy, std::string& stuff)
+{
+	stuff.clear();
+
+	if (legacy.IsNil()) return true; //新玩家
+	if (!legacy.IsString()) return false;
+
+	stuff = legacy.str;
+	return true;
+}
+
+void PlayerStorage::Save(int64_t player_id, const PlayerSections& sections, RedisBatch& batch)
+{
+	if (sections.empty()) return;
+
+	std::vector<std::string> argv = {"HMSET", GetKey(player_id)};
+
+	for (const auto& section : sections)
+	{
+		argv.push_back(section.first);
+		argv.push_back(section.second);
+	}
+
+	batch.Command(std::move(argv));
+}
+
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+namespace Adoter
+{
+
+namespace Asset
+{
+class Player;
+}
+
+class RedisBatch;
+struct RedisResult;
+
+//玩家数据分段：段名称 -> 该段的序列化数据
+typedef std::unordered_map<std::string, std::string> PlayerSections;
+
+/*
+ * 类说明：
+ *
+ * 玩家分段存储：玩家数据按字段拆成几段，存在哈希表player:<id>:section中，只写有变化的段.
+ *
+ * 每个消息类型的字段(common_prop、inventory、common_limit、player_prop...)单独一段，其余字段合并为base段.
+ *
+ * 每段是该字段的协议编码，所有段拼接起来就是完整的玩家数据，加载时直接解析.
+ *
+ * 说明：兼容旧数据，分段数据不存在时再读取player:<id>(只有未迁移的玩家多一次往返)，首次存盘写入所有段.
+ *
+ * */
+
+class PlayerStorage
+{
+public:
+	static std::string GetKey(int64_t player_id) { return "player:" + std::to_string(player_id) + ":section"; }
+	static std::string GetLegacyKey(int64_t player_id) { return "player:" + std::to_string(player_id); }
+
+	//拆分玩家数据
+	static void Split(const Asset::Player& stuff, PlayerSections& sections);
+
+	//加载命令：只读取分段数据
+	static void Load(int64_t player_id, RedisBatch& batch);
+	//合并分段数据，sections为空表示没有分段数据(需要读取旧数据)，失败返回false
+	static bool Merge(const RedisResult& hash, std::string& stuff, PlayerSections& sections);
+
+	//旧数据：分段数据不存在时读取
+	static void LoadLegacy(int64_t player_id, RedisBatch& batch);
+	static bool MergeLegacy(const RedisResult& legacy, std::string& stuff);
+
+	//存盘命令：只写入给定的段
+	static void Save(int64_t player_id, const PlayerSections& sections, RedisBatch& batch);
+};
+
+}
@@ -19,6 +19,11 @@ bool ProtocolManager::Load()
 	const pb::EnumDescriptor* meta_type = _file_descriptor->FindEnumTypeByName("META_TYPE");	
 	if (!meta_type) std::cout << __func__ << ":could not found typename:META_TYPE" << std::endl;
 
+	_protocols.clear();
+	_protocols.resize(Asset::META_TYPE_C2S_COUNT + 1);
+
+	int32_t total = 0;
+
 	for (int i = 0; i < _file_descriptor->message_type_count(); ++i)
 	{
 		const pb::Descriptor* descriptor = _file_descriptor->message_type(i);
@@ -30,16 +35,88 @@ bool ProtocolManager::Load()
 		if(!field || field->enum_type() != meta_type) continue;
 
 		int type_t = field->default_value_enum()->number();
-		if (type_t > Asset::META_TYPE_C2S_COUNT) continue; 	//只加载C2S的协议处理
+		_meta_types.emplace(descriptor, type_t); //发送协议时查找类型
+
+		if (type_t <= 0 || type_t > Asset::META_TYPE_C2S_COUNT) continue; 	//只加载C2S的协议处理
+
+		ProtocolEntry& entry = _protocols[type_t];
+		if (entry.prototype) continue; //合法协议，如果已经存在则忽略，即只加载第一个协议
 		
 		const pb::Message* msg = pb::MessageFactory::generated_factory()->GetPrototype(descriptor);
-		pb::Message* message = msg->New();
-		_messages.emplace(field->default_value_enum()->number(), message);	//合法协议，如果已经存在则忽略，即只加载第一个协议
+		entry.prototype = msg->New();
+		++total;
 	}
 
-	std::cout << __func__ << ":Load protocol success，total：" << _messages.size() << std::endl;
+	std::cout << __func__ << ":Load protocol success，total：" << total << std::endl;
 	_parse_sucess = true;
 	return true;
 }
 
+bool ProtocolManager::Register(int32_t message_type, ProtocolHandler handler)
+{
+	if (message_type <= 0 || message_type >= (int32_t)_protocols.size()) 
+	{
+		std::cout << __func__ << ":message type out of range:" << message_type << std::endl;
+		return false;
+	}
+
+	ProtocolEntry& entry = _protocols[message_type];
+	if (!entry.prototype)
+	{
+		std::cout << __func__ << ":could not found message of type:" << message_type << std::endl;
+		return false;
+	}
+
+	entry.handler = handler;
+	return true;
+}
+
+MessagePool::~MessagePool()
+{
+	for (auto& used : _used) delete used.second;
+
+	for (auto& messages : _free)
+		for (auto message : messages) delete message;
+}
+
+pb::Message* MessagePool::Acquire(int32_t type_t, const pb::Message* prototype)
+{
+	if (!prototype || type_t <= 0 || type_t >= (int32_t)_free.size()) return nullptr;
+
+	pb::Message* message = nullptr;
+
+	auto& messages = _free[type_t];
+	if (messages.empty())
+	{
+		message = prototype->New();
+	}
+	else
+	{
+		message = messages.back();
+		messages.pop_back();
+	}
+
+	_used.emplace_back(type_t, message);
+	return message;
+}
+
+void MessagePool::ReleaseAll()
+{
+	for (auto& used : _used)
+	{
+		auto& messages = _free[used.first];
+
+		if (messages.size() >= MAX_FREE_PER_TYPE) 
+		{
+			delete used.second; //突发大量协议，多余的释放
+			continue;
+		}
+
+		used.second->Clear(); //保留字段空间
+		messages.push_back(used.second);
+	}
+
+	_used.clear();
+}
+
 }
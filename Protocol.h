@@ -7,6 +7,7 @@
 #include <google/protobuf/dynamic_message.h>
 #include <google/protobuf/io/zero_copy_stream_impl.h>
 #include <google/protobuf/io/tokenizer.h>
+#include <vector>
 #include <unordered_map>
 #include <string>
 #include <iostream>
@@ -17,6 +18,18 @@ namespace Adoter {
 
 namespace pb = google::protobuf;
 
+class WorldSession;
+
+//协议处理函数：所有协议(登录、进入游戏、玩家操作)统一形式，返回0为成功
+typedef int32_t (*ProtocolHandler)(WorldSession* session, pb::Message* message);
+
+//协议注册项：原型+处理函数，按协议类型直接索引
+struct ProtocolEntry
+{
+	pb::Message* prototype = nullptr; //协议原型，接收时由此New
+	ProtocolHandler handler = nullptr; //处理函数
+};
+
 /*
  * 类功能：
  * 
@@ -34,7 +47,9 @@ private:
 	bool _parse_sucess;
 	std::string _proto_file_path;
 	
-	std::unordered_map<int32_t, pb::Message*>  _messages;
+	std::vector<ProtocolEntry> _protocols; //C2S协议表，下标即协议类型，全服共用
+	//所有协议(包括S2C)对应的类型，启动时建立，按描述符地址查找
+	std::unordered_map<const pb::Descriptor*, int32_t> _meta_types;
 
 public:
 	ProtocolManager();
@@ -45,17 +60,110 @@ public:
 		return _instance;
 	}
 	
+	//协议注册项：数组下标访问，非法类型返回空
+	const ProtocolEntry* Get(int32_t message_type) const
+	{
+		if (message_type <= 0 || message_type >= (int32_t)_protocols.size()) return nullptr;
+		return &_protocols[message_type];
+	}
+
 	pb::Message* GetMessage(int32_t message_type)
 	{
-		auto it = _messages.find(message_type);
-		if (it == _messages.end()) return nullptr;
-		return it->second;
+		const ProtocolEntry* entry = Get(message_type);
+		if (!entry) return nullptr;
+		return entry->prototype;
+	}
+
+	//注册协议处理函数：启动时调用，协议必须已经加载
+	bool Register(int32_t message_type, ProtocolHandler handler);
+	
+	//协议类型：运行时的协议(比如pb::Message*)查表，不做字符串查找
+	int32_t GetMetaType(const pb::Message& message)
+	{
+		auto it = _meta_types.find(message.GetDescriptor());
+		if (it != _meta_types.end()) return it->second;
+
+		//动态协议：反射查找
+		const pb::FieldDescriptor* field = message.GetDescriptor()->FindFieldByName("type_t");
+		if (!field || field->type() != pb::FieldDescriptor::TYPE_ENUM) return 0;
+
+		return field->default_value_enum()->number();
 	}
 	
 	//加载协议	
 	bool Load();
+
+	//读取Meta中的协议类型，不解析：type_t是第一个字段，标签为0x08
+	static int32_t PeekMetaType(const unsigned char* data, std::size_t size)
+	{
+		if (size < 2 || data[0] != 0x08) return 0;
+
+		uint32_t value = 0;
+		for (std::size_t i = 1; i < size && i < 6; ++i) //变长编码，最多5字节
+		{
+			value |= uint32_t(data[i] & 0x7f) << (7 * (i - 1));
+			if (!(data[i] & 0x80)) return value;
+		}
+		return 0;
+	}
+};
+
+/*
+ * 协议类型：
+ *
+ * 每个协议的第一个变量type_t的默认值即为其类型，生成代码中直接读取，每个协议只取一次.
+ *
+ * */
+template<class T>
+struct MetaTypeTraits
+{
+	static int32_t Type()
+	{
+		static const int32_t type_t = T::default_instance().type_t();
+		return type_t;
+	}
 };
 
 #define ProtocolInstance ProtocolManager::Instance()
 
+/*
+ * 类说明：
+ *
+ * 接收协议对象池：每个网络线程一个，按协议类型缓存已解析过的对象.
+ *
+ * 一次接收中解析的协议在处理函数返回后统一归还，Clear()保留已分配的字段空间，稳定后解析不再分配内存.
+ *
+ * 说明：处理函数中不能保存协议指针，需要保留的数据必须拷贝.
+ *
+ * */
+
+class MessagePool
+{
+private:
+	static const size_t MAX_FREE_PER_TYPE = 64; //每种协议最多缓存的空闲对象
+	
+	Asset::Meta _meta; //协议外层
+	std::vector<std::vector<pb::Message*>> _free; //空闲对象，下标为协议类型
+	std::vector<std::pair<int32_t, pb::Message*>> _used; //本次接收使用中的对象
+public:
+	MessagePool() : _free(Asset::META_TYPE_C2S_COUNT + 1) { }
+	~MessagePool();
+	MessagePool(MessagePool const& right) = delete;
+	MessagePool& operator=(MessagePool const& right) = delete;
+
+	static MessagePool& Instance()
+	{
+		static thread_local MessagePool _instance;
+		return _instance;
+	}
+
+	Asset::Meta& GetMeta() { return _meta; }
+	//获取协议对象：优先复用
+	pb::Message* Acquire(int32_t type_t, const pb::Message* prototype);
+	//归还本次接收的所有对象
+	void ReleaseAll();
+};
+
+#define MessagePoolInstance MessagePool::Instance()
+
 }
@@ -0,0 +1,141 @@
+#include <sstream>
+
+#include "ProtocolTrace.h"
+#include "CommonUtil.h"
+#include "Config.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+ProtocolTrace::ProtocolTrace() : _enabled(false), _sample_rate(0), _player_count(0)
+{
+	for (auto& type : _types) type = false;
+}
+
+void ProtocolTrace::Load()
+{
+	Clear();
+
+	std::string value;
+	std::stringstream types(ConfigInstance.GetString("ProtocolTraceTypes", ""));
+	while (std::getline(types, value, ','))
+	{
+		if (value.empty()) continue;
+
+		const pb::EnumValueDescriptor* enum_value = Asset::META_TYPE_descriptor()->FindValueByName(value); //支持协议名称
+		if (enum_value) SetType(enum_value->number(), true);
+		else SetType(std::atoi(value.c_str()), true);
+	}
+	
+	std::stringstream players(ConfigInstance.GetString("ProtocolTracePlayers", ""));
+	while (std::getline(players, value, ','))
+	{
+		if (value.empty()) continue;
+
+		SetPlayer(std::atoll(value.c_str()), true);
+	}
+
+	int32_t sample_rate = ConfigInstance.GetInt("ProtocolTraceSampleRate", 0);
+	SetSampleRate(sample_rate > 0 ? sample_rate : 0);
+	
+	std::cout << __func__ << ":protocol trace enabled:" << IsEnabled() << std::endl;
+}
+
+void ProtocolTrace::SetType(int32_t type_t, bool on)
+{
+	if (!Asset::META_TYPE_IsValid(type_t)) return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_types[type_t].exchange(on) == on) return;
+
+	_type_count += on ? 1 : -1;
+
+	Refresh();
+}
+
+void ProtocolTrace::SetPlayer(int64_t player_id, bool on)
+{
+	if (player_id <= 0) return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (on) _players.emplace(player_id);
+	else _players.erase(player_id);
+
+	_player_count = _players.size();
+
+	Refresh();
+}
+
+void ProtocolTrace::SetSampleRate(uint32_t sample_rate)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_sample_rate = sample_rate;
+
+	Refresh();
+}
+
+void ProtocolTrace::Clear()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	for (auto& type : _types) type = false;
+	_type_count = 0;
+
+	_players.clear();
+	_player_count = 0;
+
+	_sample_rate = 0;
+
+	Refresh();
+}
+
+void ProtocolTrace::Refresh()
+{
+	_enabled = _type_count > 0 || _player_count > 0 || _sample_rate > 0;
+}
+
+bool ProtocolTrace::Match(int32_t type_t, int64_t player_id)
+{
+	if (type_t > 0 && type_t < Asset::META_TYPE_ARRAYSIZE && _types[type_t].load(std::memory_order_relaxed)) return true;
+
+	if (player_id > 0 && _player_count.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_players.find(player_id) != _players.end()) return true;
+	}
+
+	uint32_t sample_rate = _sample_rate.load(std::memory_order_relaxed);
+	if (sample_rate > 0)
+	{
+		static thread_local uint32_t counter = 0; //每个线程独立计数，不做同步
+		if (++counter >= sample_rate)
+		{
+			counter = 0;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ProtocolTrace::Trace(TRACE_DIRECTION direction, int32_t type_t, int64_t player_id, const pb::Message& message)
+{
+	const pb::EnumValueDescriptor* enum_value = Asset::META_TYPE_descriptor()->FindValueByNumber(type_t);
+
+	std::string content = direction == TRACE_DIRECTION_RECV ? "recv " : "send ";
+	content += enum_value ? enum_value->name() : std::to_string(type_t);
+	content += " " + message.ShortDebugString();
+
+	auto log = make_unique<Asset::LogMessage>();
+	log->set_player_id(player_id);
+	log->set_type(direction == TRACE_DIRECTION_RECV ? Asset::RECV_PROTOCOL : Asset::SEND_PROTOCOL);
+	log->set_content(content);
+
+	LOG(TRACE, log.get());
+}
+
+}
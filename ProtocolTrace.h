@@ -0,0 +1,77 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <unordered_set>
+
+#include "P_Header.h"
+
+namespace Adoter
+{
+
+namespace pb = google::protobuf;
+
+/*
+ * 类说明：
+ *
+ * 协议跟踪：按协议类型、玩家ID或采样比例打印收发的协议内容.
+ *
+ * 关闭时收发只读取一个原子变量，不做任何格式化；运行时可随时调整.
+ *
+ * 配置：ProtocolTraceTypes(协议类型，逗号分隔)，ProtocolTracePlayers(玩家ID，逗号分隔)，ProtocolTraceSampleRate(每N个协议打印一个，0为关闭).
+ *
+ * */
+
+class ProtocolTrace
+{
+public:
+	enum TRACE_DIRECTION
+	{
+		TRACE_DIRECTION_RECV = 1, //接收
+		TRACE_DIRECTION_SEND = 2, //发送
+	};
+private:
+	std::atomic<bool> _enabled; //总开关：任意条件开启即开启
+	std::atomic<bool> _types[Asset::META_TYPE_ARRAYSIZE]; //按协议类型
+	std::atomic<uint32_t> _sample_rate; //采样
+	std::atomic<int32_t> _player_count; //跟踪的玩家数量
+
+	std::mutex _mutex;
+	std::unordered_set<int64_t> _players; //按玩家ID
+	int32_t _type_count = 0; //跟踪的协议类型数量
+	
+	void Refresh(); //重新计算总开关
+	bool Match(int32_t type_t, int64_t player_id);
+public:
+	ProtocolTrace();
+
+	static ProtocolTrace& Instance()
+	{
+		static ProtocolTrace _instance;
+		return _instance;
+	}
+
+	//读取配置：启动和重新加载配置时调用
+	void Load();
+	//运行时调整
+	void SetType(int32_t type_t, bool on);
+	void SetPlayer(int64_t player_id, bool on);
+	void SetSampleRate(uint32_t sample_rate);
+	void Clear();
+
+	bool IsEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+	//是否需要跟踪：关闭时只有一次原子读取
+	bool ShouldTrace(int32_t type_t, int64_t player_id = 0)
+	{
+		if (!IsEnabled()) return false;
+		return Match(type_t, player_id);
+	}
+
+	void Trace(TRACE_DIRECTION direction, int32_t type_t, int64_t player_id, const pb::Message& message);
+};
+
+#define ProtocolTraceInstance ProtocolTrace::Instance()
+
+}
@@ -0,0 +1,150 @@
+#include <vector>
+#include <algorithm>
+
+#include "RecordCache.h"
+#include "PlayerStorage.h"
+#include "Storage.h"
+#include "CommonUtil.h"
+#include "Config.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+void RecordCache::Load()
+{
+	int32_t capacity = ConfigInstance.GetInt("RecordCacheBytes", 64 * 1024 * 1024);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	_capacity = capacity > 0 ? capacity : 0;
+	Evict();
+}
+
+void RecordCache::Evict()
+{
+	while (_bytes > _capacity && !_records.empty())
+	{
+		const Record& record = _records.back();
+
+		_bytes -= GetSize(record);
+		_index.erase(record.key);
+		_records.pop_back();
+	}
+}
+
+void RecordCache::Put(const std::string& key, std::string value)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (_capacity == 0) return;
+
+	auto it = _index.find(key);
+	if (it != _index.end())
+	{
+		_bytes -= GetSize(*it->second);
+		_records.erase(it->second);
+		_index.erase(it);
+	}
+
+	Record record;
+	record.key = key;
+	record.value = std::move(value);
+
+	if (GetSize(record) > _capacity) return; //单条超出上限，不缓存
+
+	_bytes += GetSize(record);
+	_records.push_front(std::move(record));
+	_index.emplace(key, _records.begin());
+
+	Evict();
+}
+
+bool RecordCache::Take(const std::string& key, std::string& value)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto it = _index.find(key);
+	if (it == _index.end())
+	{
+		++_misses;
+		return false;
+	}
+
+	++_hits;
+
+	_bytes -= GetSize(*it->second);
+	value = std::move(it->second->value);
+
+	_records.erase(it->second);
+	_index.erase(it);
+
+	return true;
+}
+
+void RecordCache::Erase(const std::string& key)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto it = _index.find(key);
+	if (it == _index.end()) return;
+
+	_bytes -= GetSize(*it->second);
+	_records.erase(it->second);
+	_index.erase(it);
+}
+
+void RecordCache::Warm()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (_capacity == 0) return;
+	}
+
+	std::vector<int64_t> player_list;
+	if (!StorageInstance.GetOnlinePlayers(player_list)) return;
+
+	//每批加载若干玩家，一次往返
+	const size_t batch_count = 100;
+	size_t warmed = 0;
+
+	for (size_t begin = 0; begin < player_list.size(); begin += batch_count)
+	{
+		size_t end = std::min(begin + batch_count, player_list.size());
+		std::vector<int64_t> batch(player_list.begin() + begin, player_list.begin() + end);
+
+		std::vector<PlayerRecord> records;
+		StorageInstance.LoadPlayers(batch, records);
+
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			if (!records[i].success || records[i].stuff.empty()) continue;
+
+			Put(PlayerStorage::GetLegacyKey(batch[i]), std::move(records[i].stuff));
+			++warmed;
+		}
+	}
+
+	std::cout << __func__ << " success, players:" << warmed << std::endl;
+}
+
+void RecordCache::Report()
+{
+	size_t count = 0, bytes = 0;
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		count = _records.size();
+		bytes = _bytes;
+	}
+
+	std::string content = "record cache count:" + std::to_string(count) + " bytes:" + std::to_string(bytes) +
+		" hits:" + std::to_string(_hits) + " misses:" + std::to_string(_misses);
+
+	auto log = make_unique<Asset::LogMessage>();
+	log->set_type(Asset::SYSTEM);
+	log->set_content(content);
+
+	LOG(INFO, log.get());
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 数据缓存：保留最近下线的账号和玩家数据，重连时不再访问数据库.
+ *
+ * 按占用内存限制大小，超出后淘汰最久没有使用的(LRU)；命中后从缓存中移除，在线期间以内存中的数据为准.
+ *
+ * 停服时记录在线玩家列表，启动时预先加载到缓存(预热).
+ *
+ * 配置：RecordCacheBytes，缓存上限(字节)，默认64MB，0为不缓存.
+ *
+ * 说明：缓存中的数据与下线存盘的数据一致；不在线修改数据库的地方需要调用Erase.
+ *
+ * */
+
+class RecordCache
+{
+private:
+	struct Record
+	{
+		std::string key;
+		std::string value;
+	};
+
+	std::mutex _mutex;
+	std::list<Record> _records; //头部为最近使用
+	std::unordered_map<std::string, std::list<Record>::iterator> _index;
+	size_t _bytes = 0; //当前占用
+	size_t _capacity = 64 * 1024 * 1024;
+
+	std::atomic<uint64_t> _hits{0};
+	std::atomic<uint64_t> _misses{0};
+private:
+	static size_t GetSize(const Record& record) { return record.key.size() + record.value.size() + 64; } //64为节点开销估计
+	void Evict(); //超出上限，淘汰最久没有使用的
+public:
+	static RecordCache& Instance()
+	{
+		static RecordCache _instance;
+		return _instance;
+	}
+
+	void Load();
+
+	//加入缓存，已有则覆盖
+	void Put(const std::string& key, std::string value);
+	//取出缓存：命中则移除，返回true
+	bool Take(const std::string& key, std::string& value);
+	void Erase(const std::string& key);
+
+	//预热：加载上次停服时在线的玩家
+	void Warm();
+	//统计日志
+	void Report();
+};
+
+#define RecordCacheInstance RecordCache::Instance()
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <hiredis.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 批量命令结果：从HIREDIS回复中复制出来，回复对象释放后仍然有效.
+ *
+ * */
+
+struct RedisResult
+{
+	int32_t type = REDIS_REPLY_ERROR; //回复类型，执行失败为错误
+	int64_t integer = 0;
+	std::string str; //字符串、状态或者错误信息，二进制安全
+	std::vector<std::string> elements; //数组(比如HGETALL)，只保留字符串元素
+
+	RedisResult() {}
+	explicit RedisResult(const redisReply* reply)
+	{
+		if (!reply) return;
+
+		type = reply->type;
+		integer = reply->integer;
+		if (reply->str) str.assign(reply->str, reply->len);
+
+		if (type != REDIS_REPLY_ARRAY) return;
+
+		for (size_t i = 0; i < reply->elements; ++i)
+		{
+			const redisReply* element = reply->element[i];
+			if (element && element->str) elements.emplace_back(element->str, element->len);
+			else elements.emplace_back();
+		}
+	}
+
+	bool IsError() const { return type == REDIS_REPLY_ERROR; }
+	bool IsNil() const { return type == REDIS_REPLY_NIL; }
+	bool IsString() const { return type == REDIS_REPLY_STRING; }
+	bool IsStatus() const { return type == REDIS_REPLY_STATUS; }
+	bool IsInteger() const { return type == REDIS_REPLY_INTEGER; }
+	bool IsArray() const { return type == REDIS_REPLY_ARRAY; }
+};
+
+/*
+ * 类说明：
+ *
+ * 批量命令：先缓存多个命令，一次发送(PIPELINE)，所有回复按顺序一起返回.
+ *
+ * 参数按长度传递，序列化后的协议数据可以直接作为参数.
+ *
+ * 说明：同一批命令只需要一次网络往返，不保证原子性.
+ *
+ * */
+
+class RedisBatch
+{
+private:
+	std::vector<std::vector<std::string>> _commands;
+public:
+	RedisBatch& Command(std::vector<std::string> argv)
+	{
+		_commands.push_back(std::move(argv));
+		return *this;
+	}
+
+	RedisBatch& Get(const std::string& key) { return Command({"GET", key}); }
+	RedisBatch& Set(const std::string& key, const std::string& value) { return Command({"SET", key, value}); }
+	RedisBatch& Incr(const std::string& key) { return Command({"INCR", key}); }
+
+	const std::vector<std::vector<std::string>>& GetCommands() const { return _commands; }
+
+	size_t Size() const { return _commands.size(); }
+	bool Empty() const { return _commands.empty(); }
+	void Clear() { _commands.clear(); }
+};
+
+}
@@ -2,8 +2,15 @@
 
 #include <hiredis.h>
 #include <string>
+#include <vector>
+#include <memory>
 #include <iostream>
 
+#include "Config.h"
+#include "MXLog.h"
+#include "RedisBatch.h"
+#include "RedisShard.h"
+
 #include <Player.h>
 
 /*
@@ -17,33 +24,203 @@
 namespace Adoter
 {
 
-class Redis 
+/*
+ * 类说明：
+ *
+ * 数据库连接池：每个线程每个分片保留几个长连接，用完归还，不再每次操作都建立连接.
+ *
+ * 连接出错则释放，下次使用时重新建立；地址见RedisShard，其余从配置读取(RedisTimeout、RedisPoolSize).
+ *
+ * */
+
+class RedisPool
 {
 private:
-	std::string _hostname = "127.0.0.1";
-	int32_t _port = 6379;
-	struct timeval _timeout = {1, 500000}; //1.5秒 
+	std::string _hostname;
+	int32_t _port;
+	struct timeval _timeout;
+	size_t _pool_size;
 
-	redisContext* _client;
+	std::vector<redisContext*> _free; //空闲连接
 public:
-	~Redis() { redisFree(_client); }
+	explicit RedisPool(const RedisEndpoint& endpoint)
+	{
+		_hostname = endpoint.hostname;
+		_port = endpoint.port;
 
-	Redis() 
-	{ 
-		_client = redisConnectWithTimeout(_hostname.c_str(), _port, _timeout);
+		int32_t timeout = ConfigInstance.GetInt("RedisTimeout", 1500); //毫秒
+		_timeout = {timeout / 1000, (timeout % 1000) * 1000};
+
+		int32_t pool_size = ConfigInstance.GetInt("RedisPoolSize", 2);
+		_pool_size = pool_size > 0 ? pool_size : 1;
+	}
+
+	~RedisPool()
+	{
+		for (auto client : _free) redisFree(client);
+	}
+
+	RedisPool(RedisPool const& right) = delete;
+	RedisPool& operator=(RedisPool const& right) = delete;
+
+	//每个线程每个分片一个
+	static RedisPool& Instance(size_t shard = 0)
+	{
+		static thread_local std::vector<std::unique_ptr<RedisPool>> _instances;
+
+		if (_instances.empty()) _instances.resize(RedisShardInstance.Size());
+		if (shard >= _instances.size()) shard = 0;
+
+		auto& instance = _instances[shard];
+		if (!instance) instance.reset(new RedisPool(RedisShardInstance.GetEndpoint(shard)));
+
+		return *instance;
+	}
+
+	//借出连接：没有空闲的则新建
+	redisContext* Acquire()
+	{
+		while (!_free.empty())
+		{
+			redisContext* client = _free.back();
+			_free.pop_back();
+
+			if (client && !client->err) return client;
+			
+			if (client && REDIS_OK == redisReconnect(client)) return client; //断线重连
+
+			if (client) redisFree(client);
+		}
+
+		redisContext* client = redisConnectWithTimeout(_hostname.c_str(), _port, _timeout);
+		if (client && client->err) CP("%s:line:%d redis connect error:%s", __func__, __LINE__, client->errstr);
+
+		return client;
+	}
+
+	//归还连接：出错的连接或者超出数量则释放
+	void Release(redisContext* client)
+	{
+		if (!client) return;
+
+		if (client->err || _free.size() >= _pool_size)
+		{
+			redisFree(client);
+			return;
+		}
+
+		_free.push_back(client);
+	}
+};
+
+#define RedisPoolInstance RedisPool::Instance()
+
+/*
+ * 类说明：
+ *
+ * 数据库操作：构造时从当前线程指定分片的连接池借出连接，析构时归还.
+ *
+ * */
+
+class Redis 
+{
+private:
+	size_t _shard = 0;
+	redisContext* _client;
+
+	//执行命令：连接断开则重连一次
+	template<class... Args>
+	redisReply* Execute(const char* format, Args... args)
+	{
+		if (!_client) return nullptr;
+
+		redisReply* reply = (redisReply*)redisCommand(_client, format, args...);
+		if (reply || !_client->err) return reply;
+
+		if (REDIS_OK != redisReconnect(_client)) return nullptr;
+
+		return (redisReply*)redisCommand(_client, format, args...);
+	}
+
+	//执行命令：参数按长度传递，二进制安全
+	redisReply* Execute(const std::vector<std::string>& argv)
+	{
+		if (!_client || argv.empty()) return nullptr;
+
+		std::vector<const char*> args;
+		std::vector<size_t> lens;
+
+		for (const auto& arg : argv)
+		{
+			args.push_back(arg.data());
+			lens.push_back(arg.size());
+		}
+
+		redisReply* reply = (redisReply*)redisCommandArgv(_client, args.size(), args.data(), lens.data());
+		if (reply || !_client->err) return reply;
+
+		if (REDIS_OK != redisReconnect(_client)) return nullptr;
+
+		return (redisReply*)redisCommandArgv(_client, args.size(), args.data(), lens.data());
 	}
+public:
+	~Redis() { RedisPool::Instance(_shard).Release(_client); }
 
-	Redis(std::string& hostname, int32_t port) : _hostname(hostname), _port(port)
+	explicit Redis(size_t shard = 0) : _shard(shard)
 	{ 
-		_client = redisConnectWithTimeout(hostname.c_str(), port, _timeout);
+		_client = RedisPool::Instance(_shard).Acquire();
 	}
 
+	Redis(Redis const& right) = delete;
+	Redis& operator=(Redis const& right) = delete;
+
 	redisContext* GetClient() { return _client; }
 
 	redisReply* ExcuteCommand(std::string command)
 	{
-		redisReply* reply = (redisReply*)redisCommand(_client, command.c_str());
-		return reply;
+		return Execute(command.c_str());
+	}
+
+	//批量执行：所有命令一次发送，结果按命令顺序返回
+	//
+	//中途断开不重试(可能已经执行了一部分)，剩余命令的结果为错误
+	bool Pipeline(const RedisBatch& batch, std::vector<RedisResult>& results)
+	{
+		results.clear();
+		results.resize(batch.Size());
+
+		if (!_client || batch.Empty()) return false;
+
+		if (_client->err && REDIS_OK != redisReconnect(_client)) return false;
+
+		for (const auto& argv : batch.GetCommands())
+		{
+			std::vector<const char*> args;
+			std::vector<size_t> lens;
+
+			for (const auto& arg : argv)
+			{
+				args.push_back(arg.data());
+				lens.push_back(arg.size());
+			}
+
+			if (REDIS_OK != redisAppendCommandArgv(_client, args.size(), args.data(), lens.data())) return false;
+		}
+
+		bool success = true;
+
+		for (auto& result : results)
+		{
+			void* reply = nullptr;
+			if (REDIS_OK != redisGetReply(_client, &reply) || !reply) return false; //连接出错，归还时释放
+
+			result = RedisResult(static_cast<redisReply*>(reply));
+			if (result.IsError()) success = false;
+
+			freeReplyObject(reply);
+		}
+
+		return success;
 	}
 
 	void GetEntity(int64_t entity_id)
@@ -52,10 +229,14 @@ public:
 	
 	int64_t CreatePlayer()
 	{
-		redisReply* reply = (redisReply*)redisCommand(_client, "Incr player_counter");
+		redisReply* reply = Execute("Incr player_counter");
 		if (!reply) return 0;
 
-		if (reply->type != REDIS_REPLY_INTEGER) return 0;
+		if (reply->type != REDIS_REPLY_INTEGER) 
+		{
+			freeReplyObject(reply);
+			return 0;
+		}
 		
 		int64_t player_id = reply->integer;
 		freeReplyObject(reply);
@@ -65,20 +246,45 @@ public:
 		return player_id;
 	}
 
+	//计数器增加count，返回增加后的值，失败为0
+	int64_t IncrBy(const std::string& key, int64_t count)
+	{
+		redisReply* reply = Execute({"INCRBY", key, std::to_string(count)});
+		if (!reply) return 0;
+
+		if (reply->type != REDIS_REPLY_INTEGER) 
+		{
+			freeReplyObject(reply);
+			return 0;
+		}
+
+		int64_t value = reply->integer;
+		freeReplyObject(reply);
+
+		return value;
+	}
+
 	std::string GetPlayer(int64_t player_id)
 	{
 		std::string value = "";
 
-		std::string command = "Get player:" + std::to_string(player_id);
-		redisReply* reply = (redisReply*)redisCommand(_client, command.c_str());
+		redisReply* reply = Execute({"GET", "player:" + std::to_string(player_id)});
 
 		if (!reply) return value;
 
-		if (reply->type == REDIS_REPLY_NIL) return value;
+		if (reply->type == REDIS_REPLY_NIL) 
+		{
+			freeReplyObject(reply);
+			return value;
+		}
 		
-		if (reply->type != REDIS_REPLY_STRING) return value;
+		if (reply->type != REDIS_REPLY_STRING) 
+		{
+			freeReplyObject(reply);
+			return value;
+		}
 
-		value = reply->str;
+		value.assign(reply->str, reply->len); //序列化数据中可能有0字节
 		freeReplyObject(reply);
 
 		std::cout << __func__ << " success, player_id:" << player_id << std::endl;
@@ -88,12 +294,14 @@ public:
 	
 	void SavePlayer(int64_t player_id, std::string& stuff)
 	{
-		std::string key = "player:" + std::to_string(player_id);
-
-		redisReply* reply = (redisReply*)redisCommand(_client, "Set %s %s", key.c_str(), stuff.c_str());
+		redisReply* reply = Execute({"SET", "player:" + std::to_string(player_id), stuff});
 		if (!reply) return;
 		
-		if (reply->type != REDIS_REPLY_STRING) return;
+		if (reply->type != REDIS_REPLY_STATUS) 
+		{
+			freeReplyObject(reply);
+			return;
+		}
 
 		freeReplyObject(reply);
 		
@@ -102,10 +310,14 @@ public:
 	
 	int64_t CreateRoom()
 	{
-		redisReply* reply = (redisReply*)redisCommand(_client, "Incr room_counter");
+		redisReply* reply = Execute("Incr room_counter");
 		if (!reply) return 0;
 
-		if (reply->type != REDIS_REPLY_INTEGER) return 0;
+		if (reply->type != REDIS_REPLY_INTEGER) 
+		{
+			freeReplyObject(reply);
+			return 0;
+		}
 		
 		int64_t room_id = reply->integer;
 		freeReplyObject(reply);
@@ -119,16 +331,23 @@ public:
 	{
 		std::string value = "";
 
-		std::string command = "Get user:" + username;
-		redisReply* reply = (redisReply*)redisCommand(_client, command.c_str());
+		redisReply* reply = Execute({"GET", "user:" + username}); //账号作为参数传递，不能拼到命令格式中
 
 		if (!reply) return value;
 
-		if (reply->type == REDIS_REPLY_NIL) return value;
+		if (reply->type == REDIS_REPLY_NIL) 
+		{
+			freeReplyObject(reply);
+			return value;
+		}
 		
-		if (reply->type != REDIS_REPLY_STRING) return value;
+		if (reply->type != REDIS_REPLY_STRING) 
+		{
+			freeReplyObject(reply);
+			return value;
+		}
 
-		value = reply->str;
+		value.assign(reply->str, reply->len); //序列化数据中可能有0字节
 		freeReplyObject(reply);
 
 		std::cout << __func__ << " success, username:" << username << std::endl;
@@ -138,12 +357,14 @@ public:
 	
 	void SaveUser(std::string username, std::string& stuff)
 	{
-		std::string key = "user:" + username;
-
-		redisReply* reply = (redisReply*)redisCommand(_client, "Set %s %s", key.c_str(), stuff.c_str());
+		redisReply* reply = Execute({"SET", "user:" + username, stuff});
 		if (!reply) return;
 		
-		if (reply->type != REDIS_REPLY_STRING) return;
+		if (reply->type != REDIS_REPLY_STATUS) 
+		{
+			freeReplyObject(reply);
+			return;
+		}
 
 		freeReplyObject(reply);
 		
@@ -0,0 +1,93 @@
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+
+#include "RedisShard.h"
+#include "Config.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+RedisShard::RedisShard()
+{
+	std::string config = ConfigInstance.GetString("RedisEndpoints", "");
+
+	if (!config.empty() && !Parse(config, _endpoints))
+	{
+		CP("%s:line:%d invalid RedisEndpoints:%s, use RedisHost", __func__, __LINE__, config.c_str());
+		_endpoints.clear();
+	}
+
+	if (_endpoints.empty()) //单个数据库
+	{
+		RedisEndpoint endpoint;
+		endpoint.hostname = ConfigInstance.GetString("RedisHost", "127.0.0.1");
+		endpoint.port = ConfigInstance.GetInt("RedisPort", 6379);
+
+		_endpoints.push_back(endpoint);
+	}
+
+	std::vector<std::string> names;
+	for (const auto& endpoint : _endpoints) names.push_back(endpoint.GetName());
+
+	_ring.Build(names);
+
+	std::string meta = ConfigInstance.GetString("RedisMetaEndpoint", "");
+	if (!meta.empty())
+	{
+		std::vector<RedisEndpoint> meta_endpoints;
+		auto it = names.end();
+		if (Parse(meta, meta_endpoints) && meta_endpoints.size() == 1) it = std::find(names.begin(), names.end(), meta_endpoints[0].GetName());
+
+		if (it != names.end()) _meta_shard = it - names.begin();
+		else CP("%s:line:%d RedisMetaEndpoint:%s not in RedisEndpoints, use first shard", __func__, __LINE__, meta.c_str());
+	}
+
+	std::cout << __func__ << " redis shards:" << _endpoints.size() << " meta shard:" << _endpoints[_meta_shard].GetName() << std::endl;
+}
+
+bool RedisShard::Parse(const std::string& config, std::vector<RedisEndpoint>& endpoints)
+{
+	endpoints.clear();
+
+	size_t begin = 0;
+	while (begin <= config.size())
+	{
+		size_t end = config.find(',', begin);
+		if (end == std::string::npos) end = config.size();
+
+		std::string address = config.substr(begin, end - begin);
+		begin = end + 1;
+
+		address.erase(0, address.find_first_not_of(" \t"));
+		address.erase(address.find_last_not_of(" \t") + 1);
+		if (address.empty()) continue;
+
+		RedisEndpoint endpoint;
+
+		size_t colon = address.rfind(':');
+		if (colon == std::string::npos)
+		{
+			endpoint.hostname = address; //默认端口
+		}
+		else
+		{
+			endpoint.hostname = address.substr(0, colon);
+			endpoint.port = std::atoi(address.c_str() + colon + 1);
+		}
+
+		if (endpoint.hostname.empty() || endpoint.port <= 0 || endpoint.port > 0xffff) return false;
+
+		for (const auto& exist : endpoints)
+		{
+			if (exist.GetName() == endpoint.GetName()) return false; //重复
+		}
+
+		endpoints.push_back(endpoint);
+	}
+
+	return !endpoints.empty();
+}
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "HashRing.h"
+
+namespace Adoter
+{
+
+struct RedisEndpoint
+{
+	std::string hostname;
+	int32_t port = 6379;
+
+	std::string GetName() const { return hostname + ":" + std::to_string(port); }
+};
+
+/*
+ * 类说明：
+ *
+ * 数据库分片：账号、玩家和计数器按键的一致性哈希分到多个数据库，每个键只在一个分片.
+ *
+ * 同一玩家的所有键(分段数据和旧数据)按player:<id>分片，一次加载只访问一个数据库.
+ *
+ * 计数器和全局键(player_counter、room_counter、online_players)不参与哈希，固定在元数据分片，增减分片时不会迁移.
+ *
+ * 配置：RedisEndpoints，分片地址列表，如127.0.0.1:6379,127.0.0.1:6380；为空则只有RedisHost、RedisPort一个分片.
+ *
+ * 配置：RedisMetaEndpoint，元数据分片的地址，必须在RedisEndpoints中；为空则为第一个分片(此时调整配置时第一个分片不能变).
+ *
+ * 说明：增加分片后约1/N的键改变归属，需要把这部分数据迁移到新分片(ShardBench统计迁移比例).
+ *
+ * */
+
+class RedisShard
+{
+private:
+	std::vector<RedisEndpoint> _endpoints;
+	HashRing _ring;
+	size_t _meta_shard = 0;
+public:
+	RedisShard();
+
+	static RedisShard& Instance()
+	{
+		static RedisShard _instance;
+		return _instance;
+	}
+
+	//解析地址列表：host:port,host:port，格式错误返回false
+	static bool Parse(const std::string& config, std::vector<RedisEndpoint>& endpoints);
+
+	size_t Size() const { return _endpoints.size(); }
+	const RedisEndpoint& GetEndpoint(size_t shard) const { return _endpoints[shard < _endpoints.size() ? shard : 0]; }
+
+	//键所在的分片
+	size_t GetShard(const std::string& key) const { return _ring.Get(key); }
+	//玩家所在的分片
+	size_t GetPlayerShard(int64_t player_id) const { return _ring.Get("player:" + std::to_string(player_id)); }
+	//计数器和全局键所在的分片：固定，不随哈希环变化
+	size_t GetMetaShard() const { return _meta_shard; }
+};
+
+#define RedisShardInstance RedisShard::Instance()
+
+}
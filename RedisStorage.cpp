@@ -0,0 +1,265 @@
+#include "RedisStorage.h"
+#include "RedisManager.h"
+#include "AsyncRedis.h"
+#include "RedisShard.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+//登录脚本：KEYS[1]为账号，ARGV[1]为新账号数据，ARGV[2]为新角色ID；返回{新角色ID(已存在为0), 账号数据}
+static const char* LOGIN_SCRIPT =
+	"local user = redis.call('GET', KEYS[1]) "
+	"if user then return {0, user} end "
+	"redis.call('SET', KEYS[1], ARGV[1]) "
+	"return {tonumber(ARGV[2]), ARGV[1]}";
+
+void RedisStorage::Load()
+{
+	for (size_t shard = 0; shard < RedisShardInstance.Size(); ++shard)
+	{
+		Redis redis(shard);
+
+		RedisBatch batch;
+		batch.Command({"SCRIPT", "LOAD", LOGIN_SCRIPT});
+
+		std::vector<RedisResult> results;
+		if (!redis.Pipeline(batch, results) || !results[0].IsString())
+		{
+			CP("%s:line:%d load login script failed, shard:%s", __func__, __LINE__, RedisShardInstance.GetEndpoint(shard).GetName().c_str());
+			continue; //登录时用EVAL
+		}
+
+		_login_sha = results[0].str; //脚本相同，每个分片的SHA相同
+	}
+}
+
+void RedisStorage::GetUser(boost::asio::io_service& io_service, const std::string& username, StringCallback callback)
+{
+	std::string key = "user:" + username;
+	AsyncRedis::Dispatch(io_service, RedisShardInstance.GetShard(key), [key, callback](AsyncRedis& redis) {
+				redis.Get(key, callback);
+			});
+}
+
+void RedisStorage::SetUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, StatusCallback callback)
+{
+	std::string key = "user:" + username;
+	AsyncRedis::Dispatch(io_service, RedisShardInstance.GetShard(key), [key, value, callback](AsyncRedis& redis) {
+				redis.Set(key, value, callback);
+			});
+}
+
+void RedisStorage::LoginUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, int64_t player_id, LoginCallback callback)
+{
+	std::string key = "user:" + username;
+	std::string id = std::to_string(player_id);
+	size_t shard = RedisShardInstance.GetShard(key);
+	std::string sha = _login_sha;
+
+	auto on_reply = [callback](redisReply* reply) {
+		if (!reply || reply->type != REDIS_REPLY_ARRAY || reply->elements != 2 || 
+				reply->element[0]->type != REDIS_REPLY_INTEGER || reply->element[1]->type != REDIS_REPLY_STRING)
+		{
+			if (callback) callback(false, 0, "");
+			return;
+		}
+
+		if (callback) callback(true, reply->element[0]->integer, std::string(reply->element[1]->str, reply->element[1]->len));
+	};
+
+	AsyncRedis::Dispatch(io_service, shard, [&io_service, shard, sha, key, value, id, on_reply](AsyncRedis& redis) {
+				if (sha.empty())
+				{
+					redis.Command({"EVAL", LOGIN_SCRIPT, "1", key, value, id}, on_reply);
+					return;
+				}
+
+				//数据库重启或者切换后脚本缓存丢失(NOSCRIPT)，用EVAL重新执行，同时缓存脚本
+				redis.Command({"EVALSHA", sha, "1", key, value, id}, [&io_service, shard, key, value, id, on_reply](redisReply* reply) {
+							if (reply && reply->type == REDIS_REPLY_ERROR && std::string(reply->str, reply->len).compare(0, 8, "NOSCRIPT") == 0)
+							{
+								AsyncRedis::Instance(io_service, shard).Command({"EVAL", LOGIN_SCRIPT, "1", key, value, id}, on_reply);
+								return;
+							}
+
+							on_reply(reply);
+						});
+			});
+}
+
+void RedisStorage::LoadPlayer(boost::asio::io_service& io_service, int64_t player_id, PlayerCallback callback)
+{
+	RedisBatch batch;
+	PlayerStorage::Load(player_id, batch);
+
+	size_t shard = RedisShardInstance.GetPlayerShard(player_id);
+
+	auto on_load = [&io_service, player_id, shard, callback](const std::vector<RedisResult>& results) {
+		PlayerRecord record;
+		record.success = results.size() == 1 && PlayerStorage::Merge(results[0], record.stuff, record.sections);
+
+		if (!record.success || !record.sections.empty()) 
+		{
+			if (callback) callback(record);
+			return;
+		}
+
+		//没有分段数据，读取旧数据：回调在io_service中执行
+		RedisBatch legacy;
+		PlayerStorage::LoadLegacy(player_id, legacy);
+
+		AsyncRedis::Instance(io_service, shard).Pipeline(legacy, [callback](const std::vector<RedisResult>& results) {
+					PlayerRecord record;
+					record.success = results.size() == 1 && PlayerStorage::MergeLegacy(results[0], record.stuff);
+
+					if (callback) callback(record);
+				});
+	};
+
+	AsyncRedis::Dispatch(io_service, shard, [batch, on_load](AsyncRedis& redis) {
+				redis.Pipeline(batch, on_load);
+			});
+}
+
+void RedisStorage::SavePlayer(boost::asio::io_service& io_service, int64_t player_id, const PlayerSections& sections, StatusCallback callback)
+{
+	RedisBatch batch;
+	PlayerStorage::Save(player_id, sections, batch);
+
+	auto on_save = [callback](const std::vector<RedisResult>& results) {
+		if (callback) callback(results.empty() || results[0].IsStatus());
+	};
+
+	AsyncRedis::Dispatch(io_service, RedisShardInstance.GetPlayerShard(player_id), [batch, on_save](AsyncRedis& redis) {
+				redis.Pipeline(batch, on_save);
+			});
+}
+
+void RedisStorage::LoadPlayers(const std::vector<int64_t>& player_list, std::vector<PlayerRecord>& records)
+{
+	records.clear();
+	records.resize(player_list.size());
+
+	if (player_list.empty()) return;
+
+	//按分片分组，每个分片一次往返
+	std::vector<std::vector<size_t>> shards(RedisShardInstance.Size()); //分片 -> 玩家在player_list中的位置
+	for (size_t i = 0; i < player_list.size(); ++i) shards[RedisShardInstance.GetPlayerShard(player_list[i])].push_back(i);
+
+	for (size_t shard = 0; shard < shards.size(); ++shard)
+	{
+		const auto& indexes = shards[shard];
+		if (indexes.empty()) continue;
+
+		RedisBatch batch;
+		for (auto index : indexes) PlayerStorage::Load(player_list[index], batch);
+
+		Redis redis(shard);
+		std::vector<RedisResult> results;
+		redis.Pipeline(batch, results);
+
+		std::vector<size_t> legacy_indexes; //没有分段数据的玩家
+		for (size_t i = 0; i < indexes.size(); ++i)
+		{
+			auto& record = records[indexes[i]];
+			record.success = PlayerStorage::Merge(results[i], record.stuff, record.sections);
+
+			if (record.success && record.sections.empty()) legacy_indexes.push_back(indexes[i]);
+		}
+
+		if (legacy_indexes.empty()) continue;
+
+		//旧数据：只读取没有分段数据的玩家
+		RedisBatch legacy;
+		for (auto index : legacy_indexes) PlayerStorage::LoadLegacy(player_list[index], legacy);
+
+		redis.Pipeline(legacy, results);
+
+		for (size_t i = 0; i < legacy_indexes.size(); ++i)
+		{
+			auto& record = records[legacy_indexes[i]];
+			record.success = PlayerStorage::MergeLegacy(results[i], record.stuff);
+		}
+	}
+}
+
+bool RedisStorage::SavePlayers(const PlayerBatch& players, std::vector<int64_t>& failed)
+{
+	failed.clear();
+
+	if (players.empty()) return true;
+
+	std::vector<RedisBatch> batches(RedisShardInstance.Size());
+	std::vector<std::vector<int64_t>> shards(batches.size()); //与每个分片的批量命令顺序一致
+
+	for (const auto& player : players)
+	{
+		if (player.second.empty()) continue;
+
+		size_t shard = RedisShardInstance.GetPlayerShard(player.first);
+
+		PlayerStorage::Save(player.first, player.second, batches[shard]);
+		shards[shard].push_back(player.first);
+	}
+
+	for (size_t shard = 0; shard < shards.size(); ++shard)
+	{
+		const auto& player_list = shards[shard];
+		if (player_list.empty()) continue;
+
+		Redis redis(shard);
+		std::vector<RedisResult> results;
+		redis.Pipeline(batches[shard], results);
+
+		for (size_t i = 0; i < player_list.size(); ++i)
+		{
+			if (!results[i].IsStatus()) failed.push_back(player_list[i]);
+		}
+	}
+
+	return failed.empty();
+}
+
+int64_t RedisStorage::IncrBy(const std::string& key, int64_t count)
+{
+	Redis redis(RedisShardInstance.GetMetaShard()); //计数器固定在元数据分片
+	return redis.IncrBy(key, count);
+}
+
+bool RedisStorage::GetOnlinePlayers(std::vector<int64_t>& player_list)
+{
+	player_list.clear();
+
+	RedisBatch batch;
+	batch.Command({"SMEMBERS", "online_players"});
+
+	Redis redis(RedisShardInstance.GetMetaShard());
+	std::vector<RedisResult> results;
+	if (!redis.Pipeline(batch, results) || !results[0].IsArray()) return false;
+
+	for (const auto& element : results[0].elements)
+	{
+		int64_t player_id = std::strtoll(element.c_str(), nullptr, 10);
+		if (player_id > 0) player_list.push_back(player_id);
+	}
+
+	return true;
+}
+
+bool RedisStorage::SetOnlinePlayers(const std::vector<int64_t>& player_list)
+{
+	RedisBatch batch;
+	batch.Command({"DEL", "online_players"});
+
+	std::vector<std::string> argv = {"SADD", "online_players"};
+	for (auto player_id : player_list) argv.push_back(std::to_string(player_id));
+
+	if (argv.size() > 2) batch.Command(std::move(argv));
+
+	Redis redis(RedisShardInstance.GetMetaShard());
+	std::vector<RedisResult> results;
+	return redis.Pipeline(batch, results);
+}
+
+}
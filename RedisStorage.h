@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Storage.h"
+
+namespace Adoter
+{
+
+/*
+ * 类说明：
+ *
+ * 数据库存储：异步接口用每个网络线程的异步连接，同步接口用连接池，批量操作每个分片一次往返(PIPELINE).
+ *
+ * 键按一致性哈希分到多个数据库(见RedisShard).
+ *
+ * 登录：查询和创建账号在数据库中用脚本原子执行(EVALSHA)，一次往返.
+ *
+ * */
+
+class RedisStorage : public Storage
+{
+private:
+	std::string _login_sha; //登录脚本，启动时加载
+public:
+	//加载脚本到所有分片
+	void Load();
+
+	void GetUser(boost::asio::io_service& io_service, const std::string& username, StringCallback callback) override;
+	void SetUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, StatusCallback callback = nullptr) override;
+	void LoginUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, int64_t player_id, LoginCallback callback) override;
+
+	void LoadPlayer(boost::asio::io_service& io_service, int64_t player_id, PlayerCallback callback) override;
+	void SavePlayer(boost::asio::io_service& io_service, int64_t player_id, const PlayerSections& sections, StatusCallback callback = nullptr) override;
+
+	void LoadPlayers(const std::vector<int64_t>& player_list, std::vector<PlayerRecord>& records) override;
+	bool SavePlayers(const PlayerBatch& players, std::vector<int64_t>& failed) override;
+
+	int64_t IncrBy(const std::string& key, int64_t count) override;
+
+	bool GetOnlinePlayers(std::vector<int64_t>& player_list) override;
+	bool SetOnlinePlayers(const std::vector<int64_t>& player_list) override;
+};
+
+}
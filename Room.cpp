@@ -6,7 +6,9 @@
 #include "Room.h"
 #include "Game.h"
 #include "MXLog.h"
-#include "RedisManager.h"
+#include "CommonUtil.h"
+#include "IdAllocator.h"
+#include "ProtocolTrace.h"
 
 namespace Adoter
 {
@@ -21,26 +23,43 @@ Asset::ERROR_CODE Room::TryEnter(std::shared_ptr<Player> player)
 
 	if (!player || IsFull()) return Asset::ERROR_ROOM_IS_FULL;
 
-	auto it = std::find_if(_players.begin(), _players.end(), [player](std::shared_ptr<Player> p) {
-				return player->GetID() == p->GetID();
+	auto it = std::find_if(_seats.begin(), _seats.end(), [player](const Seat& seat) {
+				return player->GetID() == seat.player->GetID();
 			});
 
-	if (it != _players.end()) return Asset::ERROR_ROOM_HAS_BEEN_IN; //已经在房间
+	if (it != _seats.end()) return Asset::ERROR_ROOM_HAS_BEEN_IN; //已经在房间
 
 	return Asset::ERROR_SUCCESS;
 }
 
-void Room::Enter(std::shared_ptr<Player> player)
+void Room::Enter(std::shared_ptr<Player> player, const Asset::CommonProp& common_prop)
 {
-	if (TryEnter(player) != Asset::ERROR_SUCCESS) return; //进入房间之前都需要做此检查，理论上不会出现
+	auto ret = TryEnter(player);
+	if (ret != Asset::ERROR_SUCCESS) //进入房间之前都需要做此检查，多个玩家同时进入时可能出现
+	{
+		if (ret != Asset::ERROR_ROOM_HAS_BEEN_IN) 
+		{
+			player->AlertMessage(ret);
 
-	std::lock_guard<std::mutex> lock(_mutex);
+			auto room = shared_from_this();
+			player->Post([player, room]() {
+						if (player->GetRoom() == room) player->OnEnterRoomFailed(); //玩家邮箱中清理
+					});
+		}
+		return; 
+	}
 
-	DEBUG("%s:line:%d 当前房间人数:%d player_id:%ld\n", __func__, __LINE__, _players.size(), player->GetID());
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		DEBUG("%s:line:%d 当前房间人数:%d player_id:%ld\n", __func__, __LINE__, _seats.size(), player->GetID());
 
-	_players.push_back(player); //进入房间
+		Seat seat;
+		seat.player = player;
+		seat.common_prop.CopyFrom(common_prop);
 
-	player->SetPosition((Asset::POSITION_TYPE)_players.size()); //设置位置
+		_seats.push_back(std::move(seat)); //进入房间，座次为进入顺序
+	}
 
 	SyncRoom(); //同步当前房间内玩家数据
 }
@@ -52,9 +71,9 @@ void Room::OnPlayerLeave(int64_t player_id)
 
 std::shared_ptr<Player> Room::GetHoster()
 {
-	if (_players.size() <= 0) return nullptr;
+	if (_seats.size() <= 0) return nullptr;
 
-	return *_players.begin(); //房间里面的一个人就是房主
+	return _seats.begin()->player; //房间里面的一个人就是房主
 }
 
 bool Room::IsHoster(int64_t player_id)
@@ -65,22 +84,46 @@ bool Room::IsHoster(int64_t player_id)
 	return host->GetID() == player_id;
 }
 
-std::shared_ptr<Player> Room::GetPlayer(int64_t player_id)
+Room::Seat* Room::GetSeat(int64_t player_id)
 {
-	for (auto player : _players)
+	for (auto& seat : _seats)
 	{
-		if (player->GetID() == player_id) return player;
+		if (seat.player->GetID() == player_id) return &seat;
 	}
 
 	return nullptr;
 }
 
+std::shared_ptr<Player> Room::GetPlayer(int64_t player_id)
+{
+	auto seat = GetSeat(player_id);
+	if (!seat) return nullptr;
+
+	return seat->player;
+}
+
+Asset::POSITION_TYPE Room::GetPosition(int64_t player_id)
+{
+	for (size_t i = 0; i < _seats.size(); ++i)
+	{
+		if (_seats[i].player->GetID() == player_id) return Asset::POSITION_TYPE(i + 1);
+	}
+
+	return Asset::POSITION_TYPE_BEGIN;
+}
+
 void Room::OnPlayerOperate(std::shared_ptr<Player> player, pb::Message* message)
 {
 	if (!player) return;
 	
 	auto game_operate = dynamic_cast<Asset::GameOperation*>(message);
 	if (!game_operate) return;
+
+	if (game_operate->oper_type() == Asset::GAME_OPER_TYPE_KICKOUT && !IsHoster(player->GetID())) //不是房主，不能踢人
+	{
+		player->AlertMessage(Asset::ERROR_ROOM_NO_PERMISSION); //没有权限
+		return;
+	}
 			
 	BroadCast(game_operate); //广播玩家操作
 	
@@ -88,13 +131,21 @@ void Room::OnPlayerOperate(std::shared_ptr<Player> player, pb::Message* message)
 	{
 		case Asset::GAME_OPER_TYPE_START: //开始游戏：其实是个准备
 		{
+			auto seat = GetSeat(player->GetID());
+			if (!seat) return;
+
+			seat->ready = true;
+
 			if (!CanStarGame()) return;
 
+			std::vector<std::shared_ptr<Player>> players;
+			for (const auto& seat : _seats) players.push_back(seat.player);
+
 			auto game = std::make_shared<Game>();
 
 			game->Init(shared_from_this()); //洗牌
 
-			game->Start(_players); //开始游戏
+			game->Start(players); //开始游戏
 
 			GameInstance.OnCreateGame(game);
 		}
@@ -112,8 +163,11 @@ void Room::OnPlayerOperate(std::shared_ptr<Player> player, pb::Message* message)
 		}
 		break;
 		
+		case Asset::GAME_OPER_TYPE_NULL: 
 		default:
 		{
+			auto seat = GetSeat(player->GetID());
+			if (seat) seat->ready = false; //取消准备
 		}
 		break;
 	}
@@ -121,11 +175,14 @@ void Room::OnPlayerOperate(std::shared_ptr<Player> player, pb::Message* message)
 
 bool Room::Remove(int64_t player_id)
 {
-	for (auto it = _players.begin(); it != _players.end(); ++it)
+	for (auto it = _seats.begin(); it != _seats.end(); ++it)
 	{
-		if ((*it)->GetID() != player_id) continue;
+		if (it->player->GetID() != player_id) continue;
 
-		_players.erase(it); //删除玩家
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_seats.erase(it); //删除玩家
+		}
 
 		OnPlayerLeave(player_id); //玩家离开房间
 
@@ -146,11 +203,24 @@ void Room::BroadCast(pb::Message* message, int64_t exclude_player_id)
 {
 	if (!message) return;
 
-	for (auto player : _players)
+	BroadCast(WorldSession::EncodeProtocol(*message), *message, exclude_player_id); //只序列化一次，房间内玩家共用
+}
+
+void Room::BroadCast(std::shared_ptr<const std::string> frame, const pb::Message& message, int64_t exclude_player_id)
+{
+	if (!frame) return;
+
+	for (const auto& seat : _seats)
 	{
-		if (exclude_player_id == player->GetID()) continue;
+		if (exclude_player_id == seat.player->GetID()) continue;
 
-		player->SendProtocol(message);
+		seat.player->SendFrame(frame);
+	}
+	
+	if (ProtocolTraceInstance.IsEnabled()) //协议跟踪
+	{
+		int32_t type_t = ProtocolInstance.GetMetaType(message);
+		if (ProtocolTraceInstance.ShouldTrace(type_t)) ProtocolTraceInstance.Trace(ProtocolTrace::TRACE_DIRECTION_SEND, type_t, 0, message);
 	}
 }
 	
@@ -163,12 +233,15 @@ void Room::SyncRoom()
 {
 	Asset::RoomInformation message;
 	
-	for (auto player : _players)
+	for (size_t i = 0; i < _seats.size(); ++i)
 	{
-		CP("%s:line:%d 同步房间数据:%d player_id:%ld position:%d\n", __func__, __LINE__, _players.size(), player->GetID(), player->GetPosition());
+		const auto& seat = _seats[i];
+		auto position = Asset::POSITION_TYPE(i + 1);
+
+		CP("%s:line:%d 同步房间数据:%d player_id:%ld position:%d\n", __func__, __LINE__, _seats.size(), seat.player->GetID(), position);
 		auto p = message.mutable_player_list()->Add();
-		p->set_position(player->GetPosition());
-		p->mutable_common_prop()->CopyFrom(player->CommonProp());
+		p->set_position(position);
+		p->mutable_common_prop()->CopyFrom(seat.common_prop); //进入房间时的副本，不读取玩家数据
 	}
 
 	BroadCast(message);
@@ -181,11 +254,11 @@ void Room::OnCreated()
 	
 bool Room::CanStarGame()
 {
-	if (_players.size() != 4) return false;
+	if (_seats.size() != 4) return false;
 
-	for (auto player : _players)
+	for (const auto& seat : _seats)
 	{
-		if (!player->IsReady()) return false; //需要所有玩家都是准备状态
+		if (!seat.ready) return false; //需要所有玩家都是准备状态
 	}
 
 	return true;
@@ -196,6 +269,8 @@ bool Room::CanStarGame()
 /////////////////////////////////////////////////////
 std::shared_ptr<Room> RoomManager::Get(int64_t room_id)
 {
+	std::lock_guard<std::mutex> lock(_mutex);
+
 	auto it = _rooms.find(room_id);
 	if (it == _rooms.end()) return nullptr;
 	return it->second;
@@ -211,9 +286,7 @@ bool RoomManager::CheckPassword(int64_t room_id, std::string password)
 
 int64_t RoomManager::CreateRoom()
 {
-	std::shared_ptr<Redis> redis = std::make_shared<Redis>();
-	int64_t room_id = redis->CreateRoom();
-	return room_id;
+	return IdAllocatorInstance(ID_TYPE_ROOM).Allocate(); //本地分配，不等待数据库
 }
 	
 std::shared_ptr<Room> RoomManager::CreateRoom(const Asset::Room& room)
@@ -228,6 +301,8 @@ std::shared_ptr<Room> RoomManager::CreateRoom(const Asset::Room& room)
 
 void RoomManager::OnCreateRoom(std::shared_ptr<Room> room)
 {
+	std::lock_guard<std::mutex> lock(_mutex);
+
 	if (_rooms.find(room->GetID()) != _rooms.end()) return;
 
 	_rooms.emplace(room->GetID(), room);
@@ -6,7 +6,9 @@
 #include <unordered_map>
 
 #include "Asset.h"
+#include "World.h"
 #include "Player.h"
+#include "Mailbox.h"
 
 namespace Adoter
 {
@@ -21,14 +23,28 @@ class Room : public std::enable_shared_from_this<Room>
 	int32_t _banker_index = 0; //庄家索引
 	int64_t _banker = 0; //庄家
 
-	std::mutex _mutex;
+	std::mutex _mutex; //座位列表：进入房间前在玩家邮箱中检查
 
+	Mailbox _mailbox; //房间邮箱：房间和牌局逻辑都在此执行
+
+	//座位：玩家在房间中的状态属于房间，只在房间邮箱中修改，不读取玩家数据
+	struct Seat
+	{
+		std::shared_ptr<Player> player;
+		bool ready = false; //准备
+		Asset::CommonProp common_prop; //进入房间时在玩家邮箱中复制
+	};
 private:
 	std::shared_ptr<Asset::Room> _stuff; //数据
 	std::vector<std::shared_ptr<Game>> _games;
-	std::vector<std::shared_ptr<Player>> _players; //房间中的玩家：按照进房间的顺序，东南西北
+	std::vector<Seat> _seats; //房间中的玩家：按照进房间的顺序，东南西北，座次为索引+1
+private:
+	Seat* GetSeat(int64_t player_id);
 public:
-	explicit Room(Asset::Room room) {  _stuff = std::make_shared<Asset::Room>(room); }
+	explicit Room(Asset::Room room) : _mailbox(WorldInstance.GetExecutor()) {  _stuff = std::make_shared<Asset::Room>(room); }
+
+	//投递到房间邮箱：玩家进入、房间操作、牌操作都通过此接口
+	template<class F> void Post(F&& task) { _mailbox.Post(std::forward<F>(task)); }
 
 	virtual int64_t GetID() { return _stuff->room_id(); }
 
@@ -44,13 +60,13 @@ public:
 
 public:
 	Asset::ERROR_CODE TryEnter(std::shared_ptr<Player> player);
-	void Enter(std::shared_ptr<Player> player);
+	void Enter(std::shared_ptr<Player> player, const Asset::CommonProp& common_prop); //common_prop为玩家邮箱中复制的数据
 
 	void OnPlayerLeave(int64_t player_id);
 
 	void OnCreated(); 
 
-	bool IsFull() { return _players.size() >= (size_t)MAX_PLAYER_COUNT; } //房间是否已满
+	bool IsFull() { return _seats.size() >= (size_t)MAX_PLAYER_COUNT; } //房间是否已满
 
 	bool CanStarGame(); //能否开启游戏
 
@@ -58,6 +74,10 @@ public:
 
 	void BroadCast(pb::Message* message, int64_t exclude_player_id = 0);
 	void BroadCast(pb::Message& message, int64_t exclude_player_id = 0);
+	//具体协议：编译期确定类型
+	template<class T> void BroadCast(const T& message, int64_t exclude_player_id = 0) { BroadCast(WorldSession::EncodeProtocol(message), message, exclude_player_id); }
+	template<class T> void BroadCast(T* message, int64_t exclude_player_id = 0) { if (message) BroadCast(*message, exclude_player_id); }
+	void BroadCast(std::shared_ptr<const std::string> frame, const pb::Message& message, int64_t exclude_player_id = 0);
 	
 	void SyncRoom(); //房间数据
 
@@ -67,6 +87,8 @@ public:
 	bool IsHoster(int64_t player_id);
 	//获取房间中的玩家
 	std::shared_ptr<Player> GetPlayer(int64_t player_id);
+	//玩家座次：不在房间返回POSITION_TYPE_BEGIN
+	Asset::POSITION_TYPE GetPosition(int64_t player_id);
 	//删除玩家
 	bool Remove(int64_t player_id);
 	//游戏结束
@@ -82,6 +104,7 @@ public:
 class RoomManager
 {
 private:
+	std::mutex _mutex; //房间在各个线程中创建和查找
 	std::mutex _no_password_mutex;
 	//所有房间(包括已满、未满、要密码、不要密码)
 	std::unordered_map<int64_t, std::shared_ptr<Room>> _rooms;
@@ -0,0 +1,112 @@
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+
+#include "HashRing.h"
+
+/*
+ * 分片测试：按线上键的格式(user:、player:)生成键，计数器固定在元数据分片不参与统计，在进程内模拟多个数据库，统计分布和增减分片时迁移的比例.
+ *
+ * 用法：ShardBench [分片数，默认4] [键数量，默认1000000]
+ *
+ * */
+
+using namespace Adoter;
+
+static std::vector<std::string> GetNames(size_t count)
+{
+	std::vector<std::string> names;
+	for (size_t i = 0; i < count; ++i) names.push_back("127.0.0.1:" + std::to_string(6379 + i));
+
+	return names;
+}
+
+//每个键所在的分片，并输出分布
+static std::vector<size_t> Distribute(const HashRing& ring, const std::vector<std::string>& keys)
+{
+	std::vector<size_t> shards(keys.size());
+	std::vector<size_t> counts(ring.Size());
+
+	auto begin = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < keys.size(); ++i)
+	{
+		shards[i] = ring.Get(keys[i]);
+		++counts[shards[i]];
+	}
+
+	int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+
+	double average = static_cast<double>(keys.size()) / ring.Size(), variance = 0;
+	for (auto count : counts) variance += (count - average) * (count - average);
+
+	auto minmax = std::minmax_element(counts.begin(), counts.end());
+
+	std::cout << "shards:" << ring.Size() << " min:" << *minmax.first << " max:" << *minmax.second
+		<< " max/average:" << *minmax.second / average << " stddev:" << std::sqrt(variance / ring.Size()) / average * 100 << "%"
+		<< " lookup(ns):" << elapsed / static_cast<int64_t>(keys.size()) << std::endl;
+
+	return shards;
+}
+
+//比较两次分布：迁移的键数量，以及迁移是否只涉及增加或者删除的分片
+static void Compare(const std::vector<size_t>& before, const std::vector<size_t>& after, size_t changed_shard, bool added)
+{
+	size_t moved = 0, unexpected = 0;
+
+	for (size_t i = 0; i < before.size(); ++i)
+	{
+		if (before[i] == after[i]) continue;
+
+		++moved;
+
+		if (added && after[i] != changed_shard) ++unexpected; //只能移到新分片
+		if (!added && before[i] != changed_shard) ++unexpected; //只能是被删除分片上的键
+	}
+
+	std::cout << (added ? "add" : "remove") << " shard moved:" << moved << " (" << moved * 100.0 / before.size() << "%)"
+		<< " unexpected:" << unexpected << std::endl;
+}
+
+int main(int argc, const char* argv[])
+{
+	size_t shard_count = argc > 1 ? std::atoi(argv[1]) : 4;
+	size_t key_count = argc > 2 ? std::atoi(argv[2]) : 1000000;
+	if (shard_count < 2) shard_count = 4;
+	if (key_count == 0) key_count = 1000000;
+
+	std::vector<std::string> keys;
+	keys.reserve(key_count);
+
+	for (size_t i = 0; i < key_count; ++i)
+	{
+		if (i % 2) keys.push_back("player:" + std::to_string(262144 + i)); //玩家ID连续
+		else keys.push_back("user:guest" + std::to_string(i));
+	}
+
+	HashRing ring;
+	ring.Build(GetNames(shard_count));
+	auto before = Distribute(ring, keys);
+
+	//增加一个分片：期望约1/(N+1)的键移到新分片
+	HashRing added;
+	added.Build(GetNames(shard_count + 1));
+	Compare(before, Distribute(added, keys), shard_count, true);
+
+	//删除第一个分片：配置顺序变化不影响其余节点的位置，只有被删除分片的键迁移
+	std::vector<std::string> names = GetNames(shard_count);
+	names.erase(names.begin());
+
+	HashRing removed;
+	removed.Build(names);
+	auto after = Distribute(removed, keys);
+	for (auto& shard : after) ++shard; //换回原来的索引
+
+	Compare(before, after, 0, false);
+
+	return 0;
+}
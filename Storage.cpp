@@ -0,0 +1,52 @@
+#include "Storage.h"
+#include "RedisStorage.h"
+#include "MemoryStorage.h"
+#include "LogStorage.h"
+#include "CompressedStorage.h"
+#include "Config.h"
+#include "MXLog.h"
+
+namespace Adoter
+{
+
+static std::unique_ptr<Storage> _storage;
+
+bool Storage::Load()
+{
+	std::string backend = ConfigInstance.GetString("StorageBackend", "redis");
+
+	if (backend == "redis") 
+	{
+		auto storage = new RedisStorage();
+		_storage.reset(storage);
+
+		storage->Load(); //登录脚本
+	}
+	else if (backend == "memory") _storage.reset(new MemoryStorage());
+	else if (backend == "log") 
+	{
+		auto storage = new LogStorage();
+		_storage.reset(storage);
+
+		if (!storage->Load()) return false;
+	}
+	else
+	{
+		CP("%s:line:%d unknown storage backend:%s", __func__, __LINE__, backend.c_str());
+		return false;
+	}
+
+	_storage.reset(new CompressedStorage(std::move(_storage))); //读取时解压，写入时按配置压缩
+
+	std::cout << __func__ << " storage backend:" << backend << std::endl;
+	return true;
+}
+
+Storage& Storage::Instance()
+{
+	if (!_storage) _storage.reset(new CompressedStorage(std::unique_ptr<Storage>(new RedisStorage()))); //没有加载配置(工具程序)，默认数据库
+
+	return *_storage;
+}
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+#include <boost/asio.hpp>
+
+#include "PlayerStorage.h"
+
+namespace Adoter
+{
+
+//玩家数据：sections为分段数据(旧数据为空)，stuff为拼接后的完整数据
+struct PlayerRecord
+{
+	bool success = false;
+	std::string stuff;
+	PlayerSections sections;
+};
+
+/*
+ * 类说明：
+ *
+ * 存储接口：账号、玩家数据和计数器的读写，游戏逻辑不直接访问数据库.
+ *
+ * 实现：redis为数据库(默认)，log为本地日志文件(单机部署)，memory为进程内存储(压测、机器人测试用，不持久化).
+ *
+ * 异步接口在io_service中回调(网络线程)，需要修改玩家数据的回调由调用者用邮箱包装；同步接口用于存盘线程、启动和停服.
+ *
+ * 配置：StorageBackend，redis、log或者memory；StorageCompress，写入时压缩(见CompressedStorage).
+ *
+ * */
+
+class Storage
+{
+public:
+	typedef std::function<void(bool success, const std::string& value)> StringCallback; //数据不存在value为空
+	typedef std::function<void(bool success)> StatusCallback;
+	typedef std::function<void(const PlayerRecord& record)> PlayerCallback;
+	typedef std::function<void(bool success, int64_t player_id, const std::string& value)> LoginCallback; //player_id为新建的角色，账号已存在为0
+	typedef std::unordered_map<int64_t, PlayerSections> PlayerBatch; //玩家ID -> 需要写入的段
+public:
+	virtual ~Storage() {}
+
+	//账号
+	virtual void GetUser(boost::asio::io_service& io_service, const std::string& username, StringCallback callback) = 0;
+	virtual void SetUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, StatusCallback callback = nullptr) = 0;
+	//登录：账号已存在返回账号数据，不存在则写入value(包含新角色player_id)；查询和创建是一个原子操作，同一账号只会创建一次
+	virtual void LoginUser(boost::asio::io_service& io_service, const std::string& username, const std::string& value, int64_t player_id, LoginCallback callback) = 0;
+
+	//玩家
+	virtual void LoadPlayer(boost::asio::io_service& io_service, int64_t player_id, PlayerCallback callback) = 0;
+	virtual void SavePlayer(boost::asio::io_service& io_service, int64_t player_id, const PlayerSections& sections, StatusCallback callback = nullptr) = 0;
+
+	//同步：批量读写，records与player_list顺序一致，failed返回写入失败的玩家
+	virtual void LoadPlayers(const std::vector<int64_t>& player_list, std::vector<PlayerRecord>& records) = 0;
+	virtual bool SavePlayers(const PlayerBatch& players, std::vector<int64_t>& failed) = 0;
+
+	//计数器：增加count，返回增加后的值，失败为0
+	virtual int64_t IncrBy(const std::string& key, int64_t count) = 0;
+
+	//停服时在线的玩家
+	virtual bool GetOnlinePlayers(std::vector<int64_t>& player_list) = 0;
+	virtual bool SetOnlinePlayers(const std::vector<int64_t>& player_list) = 0;
+
+	//根据配置创建，启动时调用
+	static bool Load();
+	static Storage& Instance();
+};
+
+#define StorageInstance Storage::Instance()
+
+}
@@ -1,5 +1,10 @@
 #include "World.h"
 #include "Protocol.h"
+#include "WorldSession.h"
+#include "FloodControl.h"
+#include "Persist.h"
+#include "RecordCache.h"
+#include "CurrencyLedger.h"
 #include "Room.h"
 #include "Game.h"
 #include "PlayerMatch.h"
@@ -17,6 +22,12 @@ bool World::Load()
 		//LOG(ERROR, "ProtocolInstance load error.");
 		return false;
 	}
+	//协议处理函数注册
+	if (!WorldSession::RegisterHandlers())
+	{
+		//LOG(ERROR, "WorldSession register handlers error.");
+		return false;
+	}
 	//数据初始化：必须最先初始化
 	if (!AssetInstance.Load()) 
 	{
@@ -58,6 +69,11 @@ void World::Update(int32_t diff)
 	++_heart_count;
 
 	MatchInstance.Update(diff);
+
+	if (_heart_count % 1200 == 0) FloodControlInstance.Report(); //流量控制统计，每分钟一次
+	if (_heart_count % 1200 == 0) PersistInstance.Report(); //存盘统计，每分钟一次
+	if (_heart_count % 1200 == 0) RecordCacheInstance.Report(); //缓存统计，每分钟一次
+	if (_heart_count % 1200 == 0) LedgerInstance.Report(); //流水统计，每分钟一次
 }
 	
 
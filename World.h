@@ -3,6 +3,7 @@
 #include "Asset.h"
 
 #include <memory>
+#include <boost/asio.hpp>
 
 namespace Adoter 
 {
@@ -25,6 +26,7 @@ class World : public std::enable_shared_from_this<World>
 private:
 	bool _stopped = false;
 	int64_t _heart_count = 0; //心跳记次
+	boost::asio::io_service* _executor = nullptr; //世界线程池：房间等实体的邮箱在此执行
 public:
 	static World& Instance()
 	{
@@ -38,6 +40,10 @@ public:
 	void Update(int32_t diff);
 	//加载所有
 	bool Load();
+	//世界线程池：加载之前设置
+	void SetExecutor(boost::asio::io_service* executor) { _executor = executor; }
+	boost::asio::io_service& GetExecutor() { return *_executor; }
+	bool HasExecutor() { return _executor != nullptr; }
 };
 
 #define WorldInstance World::Instance()
@@ -1,19 +1,36 @@
 #include "WorldSession.h"
-#include "RedisManager.h"
 #include "CommonUtil.h"
 #include "Player.h"
 #include "MXLog.h"
+#include "ProtocolTrace.h"
+#include "FloodControl.h"
+#include "Mailbox.h"
+#include "Storage.h"
+#include "IdAllocator.h"
+#include "RecordCache.h"
 
 namespace Adoter
 {
 
 WorldSession::~WorldSession()
 {
-    KillOutPlayer();
+	//析构时已经没有持有者，不能经过OnClose投递到邮箱(shared_from_this会失败)，直接关闭连接
+	if (_closed.exchange(true)) return;
+
+	boost::system::error_code error;
+	_socket.close(error);
+}
+
+WorldSession::WorldSession(boost::asio::ip::tcp::socket&& socket) : Socket(std::move(socket)), _mailbox(_socket.get_io_service())
+{
 }
 
-WorldSession::WorldSession(boost::asio::ip::tcp::socket&& socket) : Socket(std::move(socket))
+void WorldSession::AsyncReceiveWithCallback(void(WorldSession::*callback)(boost::system::error_code, std::size_t))
 {
+	_read_buffer.Normalize();
+	_read_buffer.EnsureFreeSpace();
+	_socket.async_read_some(boost::asio::buffer(_read_buffer.GetWritePointer(), _read_buffer.GetRemainingSpace()), 
+			_mailbox.Wrap(std::bind(callback, shared_from_this(), std::placeholders::_1, std::placeholders::_2))); //在玩家邮箱中处理
 }
 
 void WorldSession::InitializeHandler(const boost::system::error_code error, const std::size_t bytes_transferred)
@@ -32,176 +49,359 @@ void WorldSession::InitializeHandler(const boost::system::error_code error, cons
 			CP("Remote client disconnect, RemoteIp:%s", _socket.remote_endpoint().address().to_string().c_str());
 			return;
 		}
-		else
-		{
-			Asset::Meta meta;
-			bool result = meta.ParseFromArray(_buffer.data(), bytes_transferred);
-
-			if (!result) 
-			{
-				log->set_content("Meta parse error, line:" + __LINE__);
-				LOG(ERROR, log.get());
-
-				Close();
-				return;		//非法协议
-			}
-			
-			//std::cout << "接收数据：";
-			//meta.PrintDebugString(); //打印出来Message.
-			//std::cout << std::endl;
-			
-			/////////////////////////////////////////////////////////////////////////////打印收到协议提示信息
-		
-			const pb::FieldDescriptor* type_field = meta.GetDescriptor()->FindFieldByName("type_t");
-			if (!type_field) return;
-
-			const pb::EnumValueDescriptor* enum_value = meta.GetReflection()->GetEnum(meta, type_field);
-			if (!enum_value) return;
-
-			const std::string& enum_name = enum_value->name();
-			DEBUG("%s:line:%d, 玩家:%ld发送协议数据:%s", __func__, __LINE__, enum_name.c_str());
-			
-			google::protobuf::Message* msg = ProtocolInstance.GetMessage(meta.type_t());	
-			if (!msg) 
-			{
-				Close();
-				CP("Could not found message of type:%d", meta.type_t());
-				return;		//非法协议
-			}
-
-			auto message = msg->New();
-			
-			//result = message->ParseFromString(meta.stuff());
-			result = message->ParseFromArray(meta.stuff().c_str(), meta.stuff().size());
-			if (!result) 
-			{
-				log->set_content("Meta parse error, line:" + __LINE__);
-				LOG(ERROR, log.get());
-
-				Close();
-				return;		//非法协议
-			}
+
+		_read_buffer.WriteCompleted(bytes_transferred);
+	}
+	catch (std::exception& e)
+	{
+		CP("异常：%s", e.what());
+		Close();
+		return;
+	}
+
+	HandleFrames();
+}
+
+void WorldSession::HandleFrames()
+{
+	try
+	{
+		//一次接收可能包含多个包，也可能只有半个包
+		bool result = ReadFrames();
 		
-			message->PrintDebugString(); //打印出来Message.
-
-			/////////////////////////////////////////////////////////////////////////////游戏逻辑处理流程
-			
-			if (Asset::META_TYPE_C2S_LOGIN == meta.type_t()) //账号登陆
-			{
-				Asset::Login* login = dynamic_cast<Asset::Login*>(message);
-				if (!login) return; 
-				
-			 	auto redis = std::make_shared<Redis>();
-				std::string stuff = redis->GetUser(login->account().username());
-
-				Asset::User user;
-
-				if (stuff.empty()) //没有数据
-				{
-					user.mutable_account()->CopyFrom(login->account());
-
-					///////如果账号下没有角色，创建一个给Client
-
-					int64_t player_id = redis->CreatePlayer();
-					if (player_id == 0) 
-					{
-						CP("Create player failed.");
-						return; //创建失败
-					}
-
-					user.mutable_player_list()->Add(player_id);
-
-					auto stuff = user.SerializeAsString();
-					redis->SaveUser(login->account().username(), stuff); //账号数据存盘
-
-					g_player = std::make_shared<Player>(player_id, shared_from_this());
-					g_player->Save(); //存盘，防止数据库无数据
-				}
-				else
-				{
-					user.ParseFromString(stuff);
-				}
-
-				///////清理状态
-				_account.Clear(); _player_list.clear();
-				//账号信息
-				_account.CopyFrom(login->account());
-				//玩家数据
-				for (auto player_id : user.player_list())
-				{
-					_player_list.emplace(player_id);
-				}
-				///////发送给Client当前的角色信息
-				Asset::PlayerList player_list;
-				player_list.mutable_player_list()->CopyFrom(user.player_list());
-				SendProtocol(player_list); //传给Client，带有角色ID
-				
-				//记录日志
-				//log->set_player_id(g_player->GetID());
-				log->set_type(Asset::PLAYER_LOGIN);
-				LOG(ACTION, log.get());
-			}
-			else if (Asset::META_TYPE_C2S_LOGOUT == meta.type_t()) //账号登出
-			{
-				Asset::Logout* logout = dynamic_cast<Asset::Logout*>(message);
-				if (!logout) return; 
-
-				KillOutPlayer();
-			}
-			else if (Asset::META_TYPE_SHARE_CREATE_PLAYER == meta.type_t()) //创建角色
-			{
-				return;
-				Asset::CreatePlayer* create_player = dynamic_cast<Asset::CreatePlayer*>(message);
-				if (!create_player) return; 
-				
-			 	std::shared_ptr<Redis> redis = std::make_shared<Redis>();
-				int64_t player_id = redis->CreatePlayer();
-				if (player_id == 0) return; //创建失败
-
-				g_player = std::make_shared<Player>(player_id, shared_from_this());
-				g_player->Save(); //存盘，防止数据库无数据
-				
-				//返回结果
-				create_player->set_player_id(player_id);
-				g_player->SendProtocol(create_player);
-			}
-			else if (Asset::META_TYPE_C2S_ENTER_GAME == meta.type_t()) //进入游戏
-			{
-				const Asset::EnterGame* enter_game = dynamic_cast<Asset::EnterGame*>(message);
-				if (!enter_game) return; 
-
-				if (_player_list.find(enter_game->player_id()) == _player_list.end())
-				{
-					Close();
-					CP("Player has not found.");
-					return; //账号下没有该角色数据
-				}
-
-				if (!g_player) g_player = std::make_shared<Player>(enter_game->player_id(), shared_from_this());
-				g_player->OnEnterGame(); //加载数据
-			}
-			else
-			{
-				if (!g_player) 
-				{
-					CP("Player has not inited");
-					return; //未初始化的Player
-				}
-				//其他协议的调用规则
-				g_player->HandleProtocol(meta.type_t(), message);
-			}
+		MessagePoolInstance.ReleaseAll(); //本次接收的协议已经处理完毕
+
+		if (!result) 
+		{
+			Close();
+			return;
 		}
 	}
 	catch (std::exception& e)
 	{
+		MessagePoolInstance.ReleaseAll();
+
 		CP("异常：%s", e.what());
 		Close();
 		return;
 	}
+
+	if (IsReadDelayed()) //流量控制：暂停接收，到时继续处理缓存中的包
+	{
+		DelayReceive();
+		return;
+	}
+
 	//递归持续接收	
 	AsyncReceiveWithCallback(&WorldSession::InitializeHandler);
 }
 
+void WorldSession::DelayReceive()
+{
+	if (!_delay_timer) _delay_timer = std::make_shared<boost::asio::deadline_timer>(_socket.get_io_service());
+
+	_delay_timer->expires_from_now(boost::posix_time::milliseconds(_delay_time));
+
+	auto self = shared_from_this();
+	_delay_timer->async_wait(_mailbox.Wrap([self](const boost::system::error_code& error) {
+				if (error || !self->IsOpen()) return;
+
+				self->HandleFrames();
+			}));
+}
+
+WorldSession::FRAME_CHECK_RESULT WorldSession::CheckFrame(const unsigned char* data, std::size_t size)
+{
+	if (!FloodControlInstance.IsEnabled()) return FRAME_CHECK_OK;
+
+	int32_t type_t = ProtocolManager::PeekMetaType(data, size); //不解析协议，只读取类型
+
+	int64_t wait_time = 0;
+	FLOOD_ACTION action = _flood_control.Check(type_t, wait_time);
+	if (FLOOD_ACTION_NONE == action) return FRAME_CHECK_OK;
+
+	uint64_t throttled_count = _flood_control.GetThrottledCount();
+	if (throttled_count == 1 || throttled_count % 100 == 0) //记录超出限制的玩家，不必每次都记录
+	{
+		boost::system::error_code error;
+		auto endpoint = _socket.remote_endpoint(error);
+
+		auto log = make_unique<Asset::LogMessage>();
+		log->set_player_id(GetPlayerID());
+		if (!error) log->set_client_ip(endpoint.address().to_string());
+		log->set_content("flood control type:" + std::to_string(type_t) + " action:" + std::to_string(action) + " throttled:" + std::to_string(throttled_count));
+		LOG(WARNNING, log.get());
+	}
+
+	switch (action)
+	{
+		case FLOOD_ACTION_DROP:
+		{
+			return FRAME_CHECK_DROP;
+		}
+		break;
+
+		case FLOOD_ACTION_DELAY:
+		{
+			_delay_time = wait_time;
+			return FRAME_CHECK_DELAY;
+		}
+		break;
+
+		default:
+		{
+			return FRAME_CHECK_CLOSE;
+		}
+		break;
+	}
+}
+
+bool WorldSession::OnReceiveFrame(const unsigned char* data, std::size_t size)
+{
+	Asset::Meta& meta = MessagePoolInstance.GetMeta(); //复用，不再每个包分配
+	bool result = meta.ParseFromArray(data, size);
+
+	if (!result) 
+	{
+		auto log = make_unique<Asset::LogMessage>();
+		log->set_content("Meta parse error, line:" + std::to_string(__LINE__));
+		LOG(ERROR, log.get());
+
+		return false;		//非法协议
+	}
+	
+	const ProtocolEntry* entry = ProtocolInstance.Get(meta.type_t());	
+	if (!entry || !entry->prototype) 
+	{
+		CP("Could not found message of type:%d", meta.type_t());
+		return false;		//非法协议
+	}
+
+	auto message = MessagePoolInstance.Acquire(meta.type_t(), entry->prototype); //处理完由对象池回收
+	if (!message) return false;
+	
+	//result = message->ParseFromString(meta.stuff());
+	result = message->ParseFromArray(meta.stuff().c_str(), meta.stuff().size());
+	if (!result) 
+	{
+		auto log = make_unique<Asset::LogMessage>();
+		log->set_content("Meta parse error, line:" + std::to_string(__LINE__));
+		LOG(ERROR, log.get());
+
+		return false;		//非法协议
+	}
+
+	if (ProtocolTraceInstance.ShouldTrace(meta.type_t(), GetPlayerID())) //协议跟踪
+	{
+		ProtocolTraceInstance.Trace(ProtocolTrace::TRACE_DIRECTION_RECV, meta.type_t(), GetPlayerID(), *message);
+	}
+
+	/////////////////////////////////////////////////////////////////////////////游戏逻辑处理流程
+	
+	if (!entry->handler)
+	{
+		CP("Could not found call back, message type is:%d", meta.type_t());
+		return true;
+	}
+
+	entry->handler(this, message);
+
+	return !_closed; //处理过程中被踢下线
+}
+
+int32_t WorldSession::CmdLogin(pb::Message* message)
+{
+	Asset::Login* login = dynamic_cast<Asset::Login*>(message);
+	if (!login) return 1; 
+
+	if (_login_pending) return 2; //正在登录，等待数据库返回
+
+	_login_pending = true;
+
+	//异步读取账号数据：协议对象由对象池回收，需要复制
+	auto self = shared_from_this();
+	Asset::Account account(login->account());
+
+	std::string stuff;
+	if (RecordCacheInstance.Take("user:" + account.username(), stuff)) //最近下线的账号
+	{
+		OnLoadUser(account, true, 0, stuff);
+		return 0;
+	}
+
+	//缓存未命中：先分配角色ID，查询和创建账号一次完成(一次往返)；账号已存在时分配的ID丢弃(ID不要求连续)
+	int64_t player_id = IdAllocatorInstance(ID_TYPE_PLAYER).Allocate();
+	if (player_id == 0) 
+	{
+		_login_pending = false;
+		CP("Allocate player id failed, username:%s", account.username().c_str());
+		AlertMessage(Asset::ERROR_INNER); //提示客户端重新登录
+		return 3;
+	}
+
+	Asset::User user;
+	user.mutable_account()->CopyFrom(account);
+	user.mutable_player_list()->Add(player_id);
+
+	StorageInstance.LoginUser(_socket.get_io_service(), account.username(), user.SerializeAsString(), player_id, _mailbox.Wrap([self, account](bool success, int64_t created_id, const std::string& stuff) {
+				self->OnLoadUser(account, success, created_id, stuff);
+			}));
+
+	return 0;
+}
+
+void WorldSession::AlertMessage(Asset::ERROR_CODE error_code, Asset::ERROR_TYPE error_type/*= Asset::ERROR_TYPE_NORMAL*/, 
+		Asset::ERROR_SHOW_TYPE error_show_type/* = Asset::ERROR_SHOW_TYPE_CHAT*/)
+{
+	Asset::AlertMessage message;
+	message.set_error_type(error_type);
+	message.set_error_show_type(error_show_type);
+	message.set_error_code(error_code);
+	SendProtocol(message);
+}
+
+void WorldSession::OnLoadUser(const Asset::Account& account, bool success, int64_t player_id, const std::string& stuff)
+{
+	if (!IsOpen()) return; //等待期间已经断开
+
+	if (!success)
+	{
+		_login_pending = false;
+		CP("Load user failed, username:%s", account.username().c_str());
+		AlertMessage(Asset::ERROR_INNER);
+		return;
+	}
+
+	Asset::User user;
+	user.ParseFromString(stuff);
+
+	if (player_id) 
+	{
+		OnCreatePlayer(account, user, player_id);
+		return;
+	}
+
+	OnLogin(account, user);
+}
+
+void WorldSession::OnCreatePlayer(const Asset::Account& account, const Asset::User& user, int64_t player_id)
+{
+	g_player = std::make_shared<Player>(player_id, shared_from_this());
+	g_player->SetLoaded(); //新角色，没有数据需要加载
+
+	//角色数据存盘，防止数据库无数据：账号已经在登录时写入
+	PlayerSections sections;
+	g_player->GetSections(sections, true);
+
+	StorageInstance.SavePlayer(_socket.get_io_service(), player_id, sections);
+
+	OnLogin(account, user);
+}
+
+void WorldSession::OnLogin(const Asset::Account& account, const Asset::User& user)
+{
+	_login_pending = false;
+
+	///////清理状态
+	_account.Clear(); _player_list.clear();
+	//账号信息
+	_account.CopyFrom(account);
+	//玩家数据
+	for (auto player_id : user.player_list())
+	{
+		_player_list.emplace(player_id);
+	}
+	///////发送给Client当前的角色信息
+	Asset::PlayerList player_list;
+	player_list.mutable_player_list()->CopyFrom(user.player_list());
+	SendProtocol(player_list); //传给Client，带有角色ID
+
+	//记录日志
+	boost::system::error_code error;
+	auto endpoint = _socket.remote_endpoint(error);
+
+	auto log = make_unique<Asset::LogMessage>();
+	if (!error) log->set_client_ip(endpoint.address().to_string());
+	log->set_type(Asset::PLAYER_LOGIN);
+	LOG(ACTION, log.get());
+}
+
+int32_t WorldSession::CmdLogout(pb::Message* message)
+{
+	Asset::Logout* logout = dynamic_cast<Asset::Logout*>(message);
+	if (!logout) return 1; 
+
+	KillOutPlayer();
+	return 0;
+}
+
+int32_t WorldSession::CmdCreatePlayer(pb::Message* message)
+{
+	return 0; //角色在登录时创建
+
+	Asset::CreatePlayer* create_player = dynamic_cast<Asset::CreatePlayer*>(message);
+	if (!create_player) return 1; 
+
+	int64_t player_id = IdAllocatorInstance(ID_TYPE_PLAYER).Allocate();
+	if (player_id == 0) return 2; //创建失败
+
+	g_player = std::make_shared<Player>(player_id, shared_from_this());
+	g_player->Save(); //存盘，防止数据库无数据
+
+	//返回结果
+	create_player->set_player_id(player_id);
+	g_player->SendProtocol(create_player);
+	return 0;
+}
+
+int32_t WorldSession::CmdEnterGame(pb::Message* message)
+{
+	const Asset::EnterGame* enter_game = dynamic_cast<Asset::EnterGame*>(message);
+	if (!enter_game) return 1; 
+
+	if (_player_list.find(enter_game->player_id()) == _player_list.end())
+	{
+		CP("Player has not found.");
+		KillOutPlayer(); //账号下没有该角色数据
+		return 2;
+	}
+
+	if (!g_player) g_player = std::make_shared<Player>(enter_game->player_id(), shared_from_this());
+	g_player->OnEnterGame(); //异步加载数据，完成后发送给Client
+
+	WorldSessionInstance.Emplace(g_player->GetID(), shared_from_this()); //在线玩家
+	PlayerInstance.Emplace(g_player->GetID(), g_player);
+	return 0;
+}
+
+bool WorldSession::RegisterHandlers()
+{
+	//会话协议
+	bool result = ProtocolInstance.Register(Asset::META_TYPE_C2S_LOGIN, &SessionHandler<&WorldSession::CmdLogin>)
+		&& ProtocolInstance.Register(Asset::META_TYPE_C2S_LOGOUT, &SessionHandler<&WorldSession::CmdLogout>)
+		&& ProtocolInstance.Register(Asset::META_TYPE_SHARE_CREATE_PLAYER, &SessionHandler<&WorldSession::CmdCreatePlayer>)
+		&& ProtocolInstance.Register(Asset::META_TYPE_C2S_ENTER_GAME, &SessionHandler<&WorldSession::CmdEnterGame>);
+	
+	//玩家协议：进入游戏后才处理
+	result = result 
+		&& ProtocolInstance.Register(Asset::META_TYPE_SHARE_CREATE_ROOM, &PlayerHandler<&Player::CmdCreateRoom>)
+		&& ProtocolInstance.Register(Asset::META_TYPE_SHARE_GAME_OPERATION, &PlayerHandler<&Player::CmdGameOperate>)
+		&& ProtocolInstance.Register(Asset::META_TYPE_SHARE_PAI_OPERATION, &PlayerHandler<&Player::CmdPaiOperate>)
+		&& ProtocolInstance.Register(Asset::META_TYPE_SHARE_BUY_SOMETHING, &PlayerHandler<&Player::CmdBuySomething>)
+		&& ProtocolInstance.Register(Asset::META_TYPE_SHARE_ENTER_ROOM, &PlayerHandler<&Player::CmdEnterRoom>)
+		&& ProtocolInstance.Register(Asset::META_TYPE_SHARE_SIGN, &PlayerHandler<&Player::CmdSign>)
+		&& ProtocolInstance.Register(Asset::META_TYPE_C2S_GET_REWARD, &PlayerHandler<&Player::CmdGetReward>)
+		&& ProtocolInstance.Register(Asset::META_TYPE_C2S_LOAD_SCENE, &PlayerHandler<&Player::CmdLoadScene>);
+
+	return result;
+}
+
+int64_t WorldSession::GetPlayerID()
+{
+	if (!g_player) return 0;
+	return g_player->GetID();
+}
+
 void WorldSession::KillOutPlayer()
 {
 	Close();
@@ -212,21 +412,39 @@ void WorldSession::Start()
 	AsyncReceiveWithCallback(&WorldSession::InitializeHandler);
 }
 	
-bool WorldSession::Update() 
-{ 
-	if (!g_player) return true; //长时间未能上线
-
-	g_player->Update(); 
-
-	return true;
+void WorldSession::OnClose()
+{
+	auto self = shared_from_this();
+	_mailbox.Dispatch([self]() { //发送失败等情况可能在其他线程关闭
+				self->OnClosed();
+			});
 }
 
-void WorldSession::OnClose()
+void WorldSession::OnClosed()
 {
+	if (_delay_timer) 
+	{
+		boost::system::error_code error;
+		_delay_timer->cancel(error);
+	}
+
+	if (!_account.username().empty()) //账号数据缓存，短时间内重连不再读取数据库
+	{
+		Asset::User user;
+		user.mutable_account()->CopyFrom(_account);
+		for (auto player_id : _player_list) user.mutable_player_list()->Add(player_id);
+
+		RecordCacheInstance.Put("user:" + _account.username(), user.SerializeAsString());
+	}
+
 	if (g_player) //网络断开
 	{
+		WorldSessionInstance.Erase(g_player->GetID(), this);
+
 		g_player->OnLogout(nullptr);
 
+		if (PlayerInstance.GetPlayer(g_player->GetID()) == g_player) PlayerInstance.Erase(g_player->GetID()); //重新登录时已经替换
+
 		g_player.reset();
 
 		g_player = nullptr;
@@ -240,20 +458,37 @@ void WorldSession::SendProtocol(pb::Message* message)
 
 void WorldSession::SendProtocol(pb::Message& message)
 {
-	message.PrintDebugString(); //打印出来MESSAGE
+	SendProtocol(ProtocolInstance.GetMetaType(message), message);
+}
 
-	const pb::FieldDescriptor* field = message.GetDescriptor()->FindFieldByName("type_t");
-	if (!field) return;
-	
-	int type_t = field->default_value_enum()->number();
-	if (!Asset::META_TYPE_IsValid(type_t)) return;	//如果不合法，不检查会宕线
+void WorldSession::SendProtocol(int32_t type_t, const pb::Message& message)
+{
+	auto frame = EncodeProtocol(type_t, message);
+	if (!frame) return;
+
+	if (ProtocolTraceInstance.ShouldTrace(type_t, GetPlayerID())) //协议跟踪
+	{
+		ProtocolTraceInstance.Trace(ProtocolTrace::TRACE_DIRECTION_SEND, type_t, GetPlayerID(), message);
+	}
+
+	AsyncSendFrame(frame);
+}
+
+std::shared_ptr<const std::string> WorldSession::EncodeProtocol(const pb::Message& message)
+{
+	return EncodeProtocol(ProtocolInstance.GetMetaType(message), message);
+}
+
+std::shared_ptr<const std::string> WorldSession::EncodeProtocol(int32_t type_t, const pb::Message& message)
+{
+	if (!Asset::META_TYPE_IsValid(type_t)) return nullptr;	//如果不合法，不检查会宕线
 	
 	Asset::Meta meta;
 	meta.set_type_t((Asset::META_TYPE)type_t);
 	meta.set_stuff(message.SerializeAsString());
 
 	std::string content = meta.SerializeAsString();
-	AsyncSend(content);
+	return MakeFrame(content.c_str(), content.size());
 }
 
 void WorldSessionManager::Add(std::shared_ptr<WorldSession> session)
@@ -265,8 +500,31 @@ void WorldSessionManager::Add(std::shared_ptr<WorldSession> session)
 void WorldSessionManager::Emplace(int64_t player_id, std::shared_ptr<WorldSession> session)
 {
 	std::lock_guard<std::mutex> lock(_mutex);
-	if (_sessions.find(player_id) == _sessions.end())
-		_sessions.emplace(player_id, session);
+	_sessions[player_id] = session; //重新连接则替换
+}
+
+void WorldSessionManager::Erase(int64_t player_id, WorldSession* session)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _sessions.find(player_id);
+	if (it == _sessions.end() || it->second.get() != session) return; //已经被新连接替换
+	_sessions.erase(it);
+}
+
+void WorldSessionManager::BroadCast(const pb::Message& message)
+{
+	auto frame = WorldSession::EncodeProtocol(message); //只序列化一次，所有连接共用
+	if (!frame) return;
+
+	BroadCast(frame);
+}
+
+void WorldSessionManager::BroadCast(std::shared_ptr<const std::string> frame)
+{
+	if (!frame) return;
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (auto& session : _sessions) session.second->AsyncSendFrame(frame);
 }
 
 size_t WorldSessionManager::GetCount()
@@ -285,12 +543,10 @@ void WorldSessionManager::OnSocketAccept(tcp::socket&& socket, int32_t thread_in
 	WorldSessionInstance.OnSocketOpen(std::forward<tcp::socket>(socket), thread_index);
 }
 
-bool WorldSessionManager::StartNetwork(boost::asio::io_service& io_service, const std::string& bind_ip, int32_t port, int thread_count)
+bool WorldSessionManager::StartNetwork(boost::asio::io_service& io_service, const std::string& bind_ip, int32_t port, int thread_count, bool reuse_port, int accept_count)
 {
-	if (!SuperSocketManager::StartNetwork(io_service, bind_ip, port, thread_count)) return false;
-	_acceptor->SetSocketFactory(std::bind(&SuperSocketManager::GetSocketForAccept, this));    
-	_acceptor->AsyncAcceptWithCallback<&OnSocketAccept>();    
-	return true;
+	if (!SuperSocketManager::StartNetwork(io_service, bind_ip, port, thread_count, reuse_port, accept_count)) return false;
+	return StartAccept<&OnSocketAccept>();
 }
 
 }
@@ -12,6 +12,8 @@
 
 #include "Socket.h"
 #include "P_Header.h"
+#include "FloodControl.h"
+#include "Mailbox.h"
 
 namespace Adoter
 {
@@ -41,27 +43,70 @@ public:
 	WorldSession& operator=(WorldSession const& right) = delete;
 	
 	virtual void Start() override;
-	virtual bool Update() override; 
 	virtual void OnClose() override;
 
+	virtual void AsyncReceiveWithCallback(void(WorldSession::*callback)(boost::system::error_code, std::size_t)) override;
 	void InitializeHandler(const boost::system::error_code error, const std::size_t bytes_transferred);
+	void HandleFrames(); //处理接收缓存中的包，然后继续接收
+	virtual FRAME_CHECK_RESULT CheckFrame(const unsigned char* data, std::size_t size) override; //流量控制
+	virtual bool OnReceiveFrame(const unsigned char* data, std::size_t size) override; //处理一个完整的包
 
 	void SendProtocol(pb::Message& message);
 	void SendProtocol(pb::Message* message);
+	//具体协议：编译期确定类型
+	template<class T> void SendProtocol(const T& message) { SendProtocol(MetaTypeTraits<T>::Type(), message); }
+	template<class T> void SendProtocol(T* message) { if (message) SendProtocol(*message); }
+	void SendProtocol(int32_t type_t, const pb::Message& message);
+	//登录失败时提示：此时还没有角色
+	void AlertMessage(Asset::ERROR_CODE error_code, Asset::ERROR_TYPE error_type = Asset::ERROR_TYPE_NORMAL, Asset::ERROR_SHOW_TYPE error_show_type = Asset::ERROR_SHOW_TYPE_CHAT);
 	void KillOutPlayer();
+	int64_t GetPlayerID(); //未进入游戏为0
+	//玩家邮箱：接收协议和玩家的定时任务都在此执行
+	Mailbox& GetMailbox() { return _mailbox; }
+	//会话协议处理：不依赖玩家
+	int32_t CmdLogin(pb::Message* message);
+	int32_t CmdLogout(pb::Message* message);
+	int32_t CmdCreatePlayer(pb::Message* message);
+	int32_t CmdEnterGame(pb::Message* message);
+	//注册所有协议处理函数：协议加载后调用一次
+	static bool RegisterHandlers();
+	//协议打包：Meta + 包头，返回可被多个连接共享的发送数据
+	static std::shared_ptr<const std::string> EncodeProtocol(const pb::Message& message);
+	template<class T> static std::shared_ptr<const std::string> EncodeProtocol(const T& message) { return EncodeProtocol(MetaTypeTraits<T>::Type(), message); }
+	static std::shared_ptr<const std::string> EncodeProtocol(int32_t type_t, const pb::Message& message);
 
 private:
+	//登录流程：异步读取数据库，回调在邮箱中执行；player_id为登录时新建的角色
+	void OnLoadUser(const Asset::Account& account, bool success, int64_t player_id, const std::string& stuff);
+	void OnCreatePlayer(const Asset::Account& account, const Asset::User& user, int64_t player_id);
+	void OnLogin(const Asset::Account& account, const Asset::User& user);
+
+	void DelayReceive(); //流量控制：暂停接收
+	void OnClosed(); //在邮箱中处理断开
+
+	Mailbox _mailbox; //玩家邮箱
 	Asset::Account _account;
 	std::unordered_set<int64_t> _player_list;
+	bool _login_pending = false; //正在登录
+	FloodControl _flood_control; //流量控制
+	int64_t _delay_time = 0; //暂停接收的时间(MS)
+	std::shared_ptr<boost::asio::deadline_timer> _delay_timer = nullptr;
 };
 
+//会话协议处理：协议表中的统一入口
+template<int32_t (WorldSession::*method)(pb::Message*)>
+int32_t SessionHandler(WorldSession* session, pb::Message* message)
+{
+	return (session->*method)(message);
+}
+
 class WorldSessionManager : public SocketManager<WorldSession> 
 {
 	typedef SocketManager<WorldSession> SuperSocketManager;
 private:
 	std::mutex _mutex;
 	std::vector<std::shared_ptr<WorldSession>> _list; //定时清理断开的会话
-	std::unordered_map<int64_t, std::shared_ptr<WorldSession>> _sessions; //根据玩家状态变化处理	
+	std::unordered_map<int64_t, std::shared_ptr<WorldSession>> _sessions; //在线玩家的连接，进入游戏时加入，断开时删除
 public:
 	static WorldSessionManager& Instance()
 	{
@@ -72,7 +117,11 @@ public:
 	size_t GetCount();
 	void Add(std::shared_ptr<WorldSession> session);
 	void Emplace(int64_t player_id, std::shared_ptr<WorldSession> session);
-	bool StartNetwork(boost::asio::io_service& io_service, const std::string& bind_ip, int32_t port, int thread_count = 1) override;
+	void Erase(int64_t player_id, WorldSession* session);
+	//全服广播：只序列化一次
+	void BroadCast(const pb::Message& message);
+	void BroadCast(std::shared_ptr<const std::string> frame);
+	bool StartNetwork(boost::asio::io_service& io_service, const std::string& bind_ip, int32_t port, int thread_count = 1, bool reuse_port = false, int accept_count = 1) override;
 protected:        
 	NetworkThread<WorldSession>* CreateThreads() const override;
 private:        